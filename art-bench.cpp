@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "avlbst.h"
+#include "art.h"
+
+using namespace std;
+
+/*
+ * Compares AdaptiveRadixTree with AVLTree<std::string, int> on URL-like
+ * keys that share long prefixes, which is where whole-string comparisons
+ * hurt the most: every comparison in the AVL tree first walks the shared
+ * part of both keys.
+ */
+
+static const size_t KEYS = 1 << 19;
+
+// Lookup results are summed into a global so the compiler cannot move
+// the timed loops past the clock reads.
+long found = 0;
+
+static string makeKey(mt19937& rng)
+{
+    static const char* const hosts[] = {
+        "https://api.example.com/v2/accounts/",
+        "https://api.example.com/v2/orders/",
+        "https://static.example.com/assets/images/",
+        "https://static.example.com/assets/scripts/"
+    };
+    ostringstream key;
+    key << hosts[rng() % 4] << rng() % 100000 << "/items/" << rng() % 1000;
+    return key.str();
+}
+
+static double nsPerOp(chrono::steady_clock::time_point start, size_t ops)
+{
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count() / ops;
+}
+
+template <typename Tree>
+void run(const char* name, Tree& tree, const vector<string>& keys,
+         const vector<string>& lookups, const vector<string>& misses)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    double insertNs = nsPerOp(start, keys.size());
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        found += tree.find(lookups[i])->second;
+    }
+    double hitNs = nsPerOp(start, lookups.size());
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < misses.size(); ++i) {
+        found += tree.find(misses[i]) != tree.end();
+    }
+    double missNs = nsPerOp(start, misses.size());
+
+    start = chrono::steady_clock::now();
+    size_t count = 0;
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        ++count;
+    }
+    double iterNs = nsPerOp(start, count);
+
+    cout << setw(20) << name << fixed << setprecision(1)
+         << setw(10) << insertNs << setw(10) << hitNs
+         << setw(10) << missNs << setw(10) << iterNs << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    mt19937 rng(7);
+    vector<string> keys, misses;
+    for (size_t i = 0; i < KEYS; ++i) {
+        keys.push_back(makeKey(rng));
+        misses.push_back(makeKey(rng) + "x");
+    }
+    // Look keys up in a different order from the one they went in.
+    vector<string> shuffled(keys);
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    cout << KEYS << " URL keys, ns per operation" << endl;
+    cout << setw(20) << "" << setw(10) << "insert" << setw(10) << "hit"
+         << setw(10) << "miss" << setw(10) << "iterate" << endl;
+    {
+        AVLTree<string, int> avl;
+        run("AVLTree<string>", avl, keys, shuffled, misses);
+    }
+    {
+        AdaptiveRadixTree<int> art;
+        run("AdaptiveRadixTree", art, keys, shuffled, misses);
+    }
+    return 0;
+}
@@ -0,0 +1,995 @@
+#ifndef ART_H
+#define ART_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+* An adaptive radix tree (ART) mapping std::string keys to values, with the
+* interface of BinarySearchTree. A lookup walks one byte of the key per level
+* and never compares whole keys until it reaches a leaf, so it costs
+* O(key length) no matter how many keys share a long prefix.
+*
+* Inner nodes come in four sizes (4, 16, 48 and 256 children) and grow or
+* shrink as children are added and removed. Each inner node also stores the
+* run of bytes that all keys below it share (path compression), so chains of
+* one-child nodes never exist. A key that ends exactly at an inner node lives
+* in that node's terminal leaf, which sorts before all of the node's
+* children. Iteration is in the same order as std::string's operator<.
+*/
+template <typename Value>
+class AdaptiveRadixTree
+{
+public:
+    AdaptiveRadixTree();
+    ~AdaptiveRadixTree();
+
+    class iterator;
+
+    std::pair<iterator, bool> insert(const std::pair<const std::string, Value>& keyValuePair);
+    void remove(const std::string& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+protected:
+    enum NodeType { LEAF, NODE4, NODE16, NODE48, NODE256 };
+
+    struct ArtNode
+    {
+        explicit ArtNode(uint8_t t) : type(t) { }
+        uint8_t type;
+    };
+
+    struct Leaf : ArtNode
+    {
+        Leaf(const std::pair<const std::string, Value>& kv) : ArtNode(LEAF), item(kv) { }
+        std::pair<const std::string, Value> item;
+    };
+
+    struct Inner : ArtNode
+    {
+        explicit Inner(uint8_t t) : ArtNode(t), count(0), terminal(NULL) { }
+        uint16_t count;       // number of children
+        std::string prefix;   // bytes shared by every key below, after the edge byte
+        Leaf* terminal;       // the key that ends at this node, if any
+    };
+
+    /**
+    * Node4 and Node16: up to N children with their edge bytes kept sorted.
+    */
+    template <int N>
+    struct SortedNode : Inner
+    {
+        SortedNode() : Inner(N == 4 ? NODE4 : NODE16) { }
+        uint8_t keys[N];
+        ArtNode* children[N];
+    };
+    typedef SortedNode<4> Node4;
+    typedef SortedNode<16> Node16;
+
+    /**
+    * Node48: a 256-entry byte map into 48 child slots (0 means no child).
+    */
+    struct Node48 : Inner
+    {
+        Node48() : Inner(NODE48)
+        {
+            memset(index, 0, sizeof(index));
+            memset(children, 0, sizeof(children));
+        }
+        uint8_t index[256];
+        ArtNode* children[48];
+    };
+
+    struct Node256 : Inner
+    {
+        Node256() : Inner(NODE256) { memset(children, 0, sizeof(children)); }
+        ArtNode* children[256];
+    };
+
+public:
+    /**
+    * A sorted iterator. It keeps the path of inner nodes above the current
+    * leaf and the position reached in each. An iterator returned by find()
+    * starts without that path, and one whose tree has since been modified
+    * has a stale path; either rebuilds it on the next increment. Leaves
+    * never move, so an iterator stays valid until its own key is removed.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const std::string, Value>& operator*() const;
+        std::pair<const std::string, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class AdaptiveRadixTree<Value>;
+
+        struct Frame
+        {
+            const Inner* node;
+            int pos;    // last position visited; -1 is the terminal
+        };
+
+        iterator(const AdaptiveRadixTree<Value>* tree, Leaf* leaf);
+        bool enter(const Inner* node);
+        void advance();
+        void seek();
+
+        const AdaptiveRadixTree<Value>* tree_;
+        Leaf* current_;
+        std::vector<Frame> stack_;
+        size_t version_;    // tree version the path was built against
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const std::string& key) const;
+    Value& operator[](const std::string& key);
+    Value const & operator[](const std::string& key) const;
+
+protected:
+    static bool isLeaf(const ArtNode* node);
+    static Leaf* asLeaf(ArtNode* node);
+    static Inner* asInner(ArtNode* node);
+    static size_t matchPrefix(const Inner* node, const std::string& key, size_t depth);
+
+    static ArtNode** findChild(Inner* node, uint8_t byte);
+    static ArtNode* nextChild(const Inner* node, int& pos);
+    static uint8_t childByte(const Inner* node, int pos);
+    static int childPosition(const Inner* node, uint8_t byte);
+    static void moveHeader(Inner* to, Inner* from);
+
+    Leaf* findLeaf(const std::string& key) const;
+    void addChild(ArtNode*& ref, Inner* node, uint8_t byte, ArtNode* child);
+    void removeChild(ArtNode*& ref, Inner* node, uint8_t byte);
+    void collapse(ArtNode*& ref, Inner* node);
+    void destroyNode(ArtNode* node);
+    void clearHelper(ArtNode* node);
+
+    ArtNode* root_;
+    size_t size_;
+    size_t version_;    // bumped by every insertion or removal of a key
+
+private:
+    AdaptiveRadixTree(const AdaptiveRadixTree&);
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree&);
+};
+
+/*
+  ------------------------------------------------------
+  Begin implementations for the AdaptiveRadixTree::iterator
+  ------------------------------------------------------
+*/
+
+template<class Value>
+AdaptiveRadixTree<Value>::iterator::iterator() :
+    tree_(NULL), current_(NULL), version_(0)
+{
+
+}
+
+template<class Value>
+AdaptiveRadixTree<Value>::iterator::iterator(const AdaptiveRadixTree<Value>* tree, Leaf* leaf) :
+    tree_(tree), current_(leaf), version_(tree->version_)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Value>
+std::pair<const std::string, Value>&
+AdaptiveRadixTree<Value>::iterator::operator*() const
+{
+    return current_->item;
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Value>
+std::pair<const std::string, Value>*
+AdaptiveRadixTree<Value>::iterator::operator->() const
+{
+    return &(current_->item);
+}
+
+template<class Value>
+bool AdaptiveRadixTree<Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Value>
+bool AdaptiveRadixTree<Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Pushes an inner node and stops on its terminal leaf if it has one.
+*/
+template<class Value>
+bool AdaptiveRadixTree<Value>::iterator::enter(const Inner* node)
+{
+    Frame f = { node, -1 };
+    stack_.push_back(f);
+    if (node->terminal != NULL) {
+        current_ = node->terminal;
+        return true;
+    }
+    return false;
+}
+
+/**
+* Moves to the next leaf in key order, or to end() after the last one.
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::iterator::advance()
+{
+    while (!stack_.empty()) {
+        Frame& f = stack_.back();
+        ArtNode* child = nextChild(f.node, f.pos);
+        if (child == NULL) {
+            stack_.pop_back();
+        }
+        else if (isLeaf(child)) {
+            current_ = asLeaf(child);
+            return;
+        }
+        else if (enter(asInner(child))) {
+            return;
+        }
+    }
+    current_ = NULL;
+}
+
+/**
+* Rebuilds the path from the root to the current leaf.
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::iterator::seek()
+{
+    const std::string& key = current_->item.first;
+    ArtNode* node = tree_->root_;
+    size_t depth = 0;
+    while (!isLeaf(node)) {
+        Inner* inner = asInner(node);
+        depth += inner->prefix.size();
+        Frame f = { inner, -1 };
+        if (depth == key.size()) {
+            stack_.push_back(f);
+            return;
+        }
+        f.pos = childPosition(inner, key[depth]);
+        stack_.push_back(f);
+        node = *findChild(inner, key[depth]);
+        ++depth;
+    }
+}
+
+/**
+* Advances the iterator.
+*/
+template<class Value>
+typename AdaptiveRadixTree<Value>::iterator&
+AdaptiveRadixTree<Value>::iterator::operator++()
+{
+    if (stack_.empty() || version_ != tree_->version_) {
+        stack_.clear();
+        seek();
+        version_ = tree_->version_;
+    }
+    advance();
+    return *this;
+}
+
+/*
+  ----------------------------------------------------
+  End implementations for the AdaptiveRadixTree::iterator
+  ----------------------------------------------------
+*/
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AdaptiveRadixTree class.
+  -------------------------------------------------
+*/
+
+template<class Value>
+AdaptiveRadixTree<Value>::AdaptiveRadixTree() :
+    root_(NULL), size_(0), version_(0)
+{
+
+}
+
+template<class Value>
+AdaptiveRadixTree<Value>::~AdaptiveRadixTree()
+{
+    clear();
+}
+
+template<class Value>
+bool AdaptiveRadixTree<Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Value>
+size_t AdaptiveRadixTree<Value>::size() const
+{
+    return size_;
+}
+
+template<class Value>
+void AdaptiveRadixTree<Value>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+    size_ = 0;
+    ++version_;
+}
+
+template<class Value>
+void AdaptiveRadixTree<Value>::clearHelper(ArtNode* node)
+{
+    if (node == NULL) {
+        return;
+    }
+    if (!isLeaf(node)) {
+        Inner* inner = asInner(node);
+        int pos = -1;
+        for (ArtNode* child = nextChild(inner, pos); child != NULL; child = nextChild(inner, pos)) {
+            clearHelper(child);
+        }
+        destroyNode(inner->terminal);
+    }
+    destroyNode(node);
+}
+
+/**
+* Frees a single node (not its children).
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::destroyNode(ArtNode* node)
+{
+    if (node == NULL) {
+        return;
+    }
+    switch (node->type) {
+    case LEAF:    delete static_cast<Leaf*>(node); break;
+    case NODE4:   delete static_cast<Node4*>(node); break;
+    case NODE16:  delete static_cast<Node16*>(node); break;
+    case NODE48:  delete static_cast<Node48*>(node); break;
+    case NODE256: delete static_cast<Node256*>(node); break;
+    }
+}
+
+template<class Value>
+bool AdaptiveRadixTree<Value>::isLeaf(const ArtNode* node)
+{
+    return node->type == LEAF;
+}
+
+template<class Value>
+typename AdaptiveRadixTree<Value>::Leaf* AdaptiveRadixTree<Value>::asLeaf(ArtNode* node)
+{
+    return static_cast<Leaf*>(node);
+}
+
+template<class Value>
+typename AdaptiveRadixTree<Value>::Inner* AdaptiveRadixTree<Value>::asInner(ArtNode* node)
+{
+    return static_cast<Inner*>(node);
+}
+
+/**
+* Returns how many bytes of node's prefix match key starting at depth.
+*/
+template<class Value>
+size_t AdaptiveRadixTree<Value>::matchPrefix(const Inner* node, const std::string& key, size_t depth)
+{
+    size_t limit = std::min(node->prefix.size(), key.size() - depth);
+    size_t i = 0;
+    while (i < limit && node->prefix[i] == key[depth + i]) {
+        ++i;
+    }
+    return i;
+}
+
+/**
+* Returns the slot holding the child under the given edge byte, or NULL.
+*/
+template<class Value>
+typename AdaptiveRadixTree<Value>::ArtNode**
+AdaptiveRadixTree<Value>::findChild(Inner* node, uint8_t byte)
+{
+    switch (node->type) {
+    case NODE4: {
+        Node4* n = static_cast<Node4*>(node);
+        for (int i = 0; i < n->count; ++i) {
+            if (n->keys[i] == byte) {
+                return &n->children[i];
+            }
+        }
+        return NULL;
+    }
+    case NODE16: {
+        Node16* n = static_cast<Node16*>(node);
+        for (int i = 0; i < n->count; ++i) {
+            if (n->keys[i] == byte) {
+                return &n->children[i];
+            }
+        }
+        return NULL;
+    }
+    case NODE48: {
+        Node48* n = static_cast<Node48*>(node);
+        return n->index[byte] != 0 ? &n->children[n->index[byte] - 1] : NULL;
+    }
+    default: {
+        Node256* n = static_cast<Node256*>(node);
+        return n->children[byte] != NULL ? &n->children[byte] : NULL;
+    }
+    }
+}
+
+/**
+* Returns the first child after position pos in edge-byte order and moves
+* pos to it, or returns NULL when there are no more. Positions are indices
+* into Node4/Node16 and edge bytes in Node48/Node256; -1 comes before all.
+*/
+template<class Value>
+typename AdaptiveRadixTree<Value>::ArtNode*
+AdaptiveRadixTree<Value>::nextChild(const Inner* node, int& pos)
+{
+    switch (node->type) {
+    case NODE4:
+        if (pos + 1 < node->count) {
+            return static_cast<const Node4*>(node)->children[++pos];
+        }
+        return NULL;
+    case NODE16:
+        if (pos + 1 < node->count) {
+            return static_cast<const Node16*>(node)->children[++pos];
+        }
+        return NULL;
+    case NODE48: {
+        const Node48* n = static_cast<const Node48*>(node);
+        for (int b = pos + 1; b < 256; ++b) {
+            if (n->index[b] != 0) {
+                pos = b;
+                return n->children[n->index[b] - 1];
+            }
+        }
+        return NULL;
+    }
+    default: {
+        const Node256* n = static_cast<const Node256*>(node);
+        for (int b = pos + 1; b < 256; ++b) {
+            if (n->children[b] != NULL) {
+                pos = b;
+                return n->children[b];
+            }
+        }
+        return NULL;
+    }
+    }
+}
+
+/**
+* The edge byte of the child at a position returned by nextChild.
+*/
+template<class Value>
+uint8_t AdaptiveRadixTree<Value>::childByte(const Inner* node, int pos)
+{
+    switch (node->type) {
+    case NODE4:  return static_cast<const Node4*>(node)->keys[pos];
+    case NODE16: return static_cast<const Node16*>(node)->keys[pos];
+    default:     return static_cast<uint8_t>(pos);
+    }
+}
+
+/**
+* The nextChild position of the child under an edge byte that exists.
+*/
+template<class Value>
+int AdaptiveRadixTree<Value>::childPosition(const Inner* node, uint8_t byte)
+{
+    if (node->type == NODE4 || node->type == NODE16) {
+        const uint8_t* keys = node->type == NODE4 ? static_cast<const Node4*>(node)->keys
+                                                  : static_cast<const Node16*>(node)->keys;
+        int i = 0;
+        while (keys[i] != byte) {
+            ++i;
+        }
+        return i;
+    }
+    return byte;
+}
+
+/**
+* Hands the prefix, terminal and count of one inner node to its
+* replacement when a node changes size.
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::moveHeader(Inner* to, Inner* from)
+{
+    to->prefix.swap(from->prefix);
+    to->terminal = from->terminal;
+    to->count = from->count;
+}
+
+/**
+* Adds a child under a new edge byte, first growing the node into the next
+* size up if it is full (ref is updated to point at the new node).
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::addChild(ArtNode*& ref, Inner* node, uint8_t byte, ArtNode* child)
+{
+    switch (node->type) {
+    case NODE4: {
+        Node4* n = static_cast<Node4*>(node);
+        if (n->count == 4) {
+            Node16* grown = new Node16();
+            moveHeader(grown, n);
+            memcpy(grown->keys, n->keys, sizeof(n->keys));
+            memcpy(grown->children, n->children, sizeof(n->children));
+            delete n;
+            ref = grown;
+            addChild(ref, grown, byte, child);
+            return;
+        }
+        int i = n->count;
+        while (i > 0 && n->keys[i - 1] > byte) {
+            n->keys[i] = n->keys[i - 1];
+            n->children[i] = n->children[i - 1];
+            --i;
+        }
+        n->keys[i] = byte;
+        n->children[i] = child;
+        ++n->count;
+        return;
+    }
+    case NODE16: {
+        Node16* n = static_cast<Node16*>(node);
+        if (n->count == 16) {
+            Node48* grown = new Node48();
+            moveHeader(grown, n);
+            for (int i = 0; i < 16; ++i) {
+                grown->index[n->keys[i]] = static_cast<uint8_t>(i + 1);
+                grown->children[i] = n->children[i];
+            }
+            delete n;
+            ref = grown;
+            addChild(ref, grown, byte, child);
+            return;
+        }
+        int i = n->count;
+        while (i > 0 && n->keys[i - 1] > byte) {
+            n->keys[i] = n->keys[i - 1];
+            n->children[i] = n->children[i - 1];
+            --i;
+        }
+        n->keys[i] = byte;
+        n->children[i] = child;
+        ++n->count;
+        return;
+    }
+    case NODE48: {
+        Node48* n = static_cast<Node48*>(node);
+        if (n->count == 48) {
+            Node256* grown = new Node256();
+            moveHeader(grown, n);
+            for (int b = 0; b < 256; ++b) {
+                if (n->index[b] != 0) {
+                    grown->children[b] = n->children[n->index[b] - 1];
+                }
+            }
+            delete n;
+            ref = grown;
+            addChild(ref, grown, byte, child);
+            return;
+        }
+        int slot = 0;
+        while (n->children[slot] != NULL) {
+            ++slot;
+        }
+        n->children[slot] = child;
+        n->index[byte] = static_cast<uint8_t>(slot + 1);
+        ++n->count;
+        return;
+    }
+    default: {
+        Node256* n = static_cast<Node256*>(node);
+        n->children[byte] = child;
+        ++n->count;
+        return;
+    }
+    }
+}
+
+/**
+* Removes the child under an edge byte, then shrinks the node into the
+* next size down once it is well below that size's capacity (the gap
+* keeps alternating inserts and removals from resizing every time).
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::removeChild(ArtNode*& ref, Inner* node, uint8_t byte)
+{
+    switch (node->type) {
+    case NODE4:
+    case NODE16: {
+        uint8_t* keys = node->type == NODE4 ? static_cast<Node4*>(node)->keys
+                                            : static_cast<Node16*>(node)->keys;
+        ArtNode** children = node->type == NODE4 ? static_cast<Node4*>(node)->children
+                                                 : static_cast<Node16*>(node)->children;
+        int i = childPosition(node, byte);
+        for (; i + 1 < node->count; ++i) {
+            keys[i] = keys[i + 1];
+            children[i] = children[i + 1];
+        }
+        --node->count;
+        if (node->type == NODE4) {
+            collapse(ref, node);
+        }
+        else if (node->count == 3) {
+            Node16* n = static_cast<Node16*>(node);
+            Node4* shrunk = new Node4();
+            moveHeader(shrunk, n);
+            memcpy(shrunk->keys, n->keys, 3);
+            memcpy(shrunk->children, n->children, 3 * sizeof(ArtNode*));
+            delete n;
+            ref = shrunk;
+        }
+        return;
+    }
+    case NODE48: {
+        Node48* n = static_cast<Node48*>(node);
+        n->children[n->index[byte] - 1] = NULL;
+        n->index[byte] = 0;
+        --n->count;
+        if (n->count == 12) {
+            Node16* shrunk = new Node16();
+            moveHeader(shrunk, n);
+            int i = 0;
+            for (int b = 0; b < 256; ++b) {
+                if (n->index[b] != 0) {
+                    shrunk->keys[i] = static_cast<uint8_t>(b);
+                    shrunk->children[i] = n->children[n->index[b] - 1];
+                    ++i;
+                }
+            }
+            delete n;
+            ref = shrunk;
+        }
+        return;
+    }
+    default: {
+        Node256* n = static_cast<Node256*>(node);
+        n->children[byte] = NULL;
+        --n->count;
+        if (n->count == 37) {
+            Node48* shrunk = new Node48();
+            moveHeader(shrunk, n);
+            int slot = 0;
+            for (int b = 0; b < 256; ++b) {
+                if (n->children[b] != NULL) {
+                    shrunk->index[b] = static_cast<uint8_t>(slot + 1);
+                    shrunk->children[slot++] = n->children[b];
+                }
+            }
+            delete n;
+            ref = shrunk;
+        }
+        return;
+    }
+    }
+}
+
+/**
+* Replaces a Node4 that is down to a single entry by that entry. A lone
+* inner child absorbs the node's prefix and edge byte into its own prefix.
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::collapse(ArtNode*& ref, Inner* node)
+{
+    if (node->count == 0 && node->terminal != NULL) {
+        ref = node->terminal;
+    }
+    else if (node->count == 1 && node->terminal == NULL) {
+        int pos = -1;
+        ArtNode* child = nextChild(node, pos);
+        if (!isLeaf(child)) {
+            Inner* inner = asInner(child);
+            std::string merged;
+            merged.reserve(node->prefix.size() + 1 + inner->prefix.size());
+            merged.append(node->prefix);
+            merged.push_back(static_cast<char>(childByte(node, pos)));
+            merged.append(inner->prefix);
+            inner->prefix.swap(merged);
+        }
+        ref = child;
+    }
+    else {
+        return;
+    }
+    node->terminal = NULL;
+    destroyNode(node);
+}
+
+/**
+* Returns the leaf holding key, or NULL. Costs one step per key byte
+* consumed plus a single full-key comparison at the end.
+*/
+template<class Value>
+typename AdaptiveRadixTree<Value>::Leaf*
+AdaptiveRadixTree<Value>::findLeaf(const std::string& key) const
+{
+    ArtNode* node = root_;
+    size_t depth = 0;
+    while (node != NULL) {
+        if (isLeaf(node)) {
+            Leaf* leaf = asLeaf(node);
+            return leaf->item.first == key ? leaf : NULL;
+        }
+        Inner* inner = asInner(node);
+        if (matchPrefix(inner, key, depth) != inner->prefix.size()) {
+            return NULL;
+        }
+        depth += inner->prefix.size();
+        if (depth == key.size()) {
+            return inner->terminal;
+        }
+        ArtNode** child = findChild(inner, key[depth]);
+        node = child != NULL ? *child : NULL;
+        ++depth;
+    }
+    return NULL;
+}
+
+template<class Value>
+typename AdaptiveRadixTree<Value>::iterator
+AdaptiveRadixTree<Value>::begin() const
+{
+    iterator it(this, NULL);
+    if (root_ == NULL) {
+        return it;
+    }
+    if (isLeaf(root_)) {
+        it.current_ = asLeaf(root_);
+    }
+    else if (!it.enter(asInner(root_))) {
+        it.advance();
+    }
+    return it;
+}
+
+template<class Value>
+typename AdaptiveRadixTree<Value>::iterator
+AdaptiveRadixTree<Value>::end() const
+{
+    return iterator(this, NULL);
+}
+
+template<class Value>
+typename AdaptiveRadixTree<Value>::iterator
+AdaptiveRadixTree<Value>::find(const std::string& key) const
+{
+    return iterator(this, findLeaf(key));
+}
+
+/**
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent
+ */
+template<class Value>
+Value& AdaptiveRadixTree<Value>::operator[](const std::string& key)
+{
+    Leaf* leaf = findLeaf(key);
+    if (leaf == NULL) {
+        leaf = insert(std::make_pair(key, Value())).first.current_;
+    }
+    return leaf->item.second;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Value>
+Value const & AdaptiveRadixTree<Value>::operator[](const std::string& key) const
+{
+    Leaf* leaf = findLeaf(key);
+    if(leaf == NULL) throw std::out_of_range("Invalid key");
+    return leaf->item.second;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Returns an iterator to the item and whether it was inserted.
+ */
+template<class Value>
+std::pair<typename AdaptiveRadixTree<Value>::iterator, bool>
+AdaptiveRadixTree<Value>::insert(const std::pair<const std::string, Value>& keyValuePair)
+{
+    const std::string& key = keyValuePair.first;
+    ArtNode** ref = &root_;
+    size_t depth = 0;
+    while (true) {
+        ArtNode* node = *ref;
+        if (node == NULL) {
+            Leaf* leaf = new Leaf(keyValuePair);
+            *ref = leaf;
+            ++size_;
+            ++version_;
+            return std::make_pair(iterator(this, leaf), true);
+        }
+
+        if (isLeaf(node)) {
+            Leaf* existing = asLeaf(node);
+            const std::string& other = existing->item.first;
+            if (other == key) {
+                existing->item.second = keyValuePair.second;
+                return std::make_pair(iterator(this, existing), false);
+            }
+            // Split the leaf: a new Node4 takes the bytes both keys share,
+            // and each key hangs off it by its next byte (or as the terminal
+            // if it ends there).
+            size_t split = depth;
+            while (split < key.size() && split < other.size() && key[split] == other[split]) {
+                ++split;
+            }
+            Node4* branch = new Node4();
+            branch->prefix.assign(key, depth, split - depth);
+            Leaf* leaf = new Leaf(keyValuePair);
+            ArtNode* branchRef = branch;
+            if (other.size() == split) {
+                branch->terminal = existing;
+            }
+            else {
+                addChild(branchRef, branch, other[split], existing);
+            }
+            if (key.size() == split) {
+                branch->terminal = leaf;
+            }
+            else {
+                addChild(branchRef, branch, key[split], leaf);
+            }
+            *ref = branch;
+            ++size_;
+            ++version_;
+            return std::make_pair(iterator(this, leaf), true);
+        }
+
+        Inner* inner = asInner(node);
+        size_t matched = matchPrefix(inner, key, depth);
+        if (matched < inner->prefix.size()) {
+            // The key leaves the compressed path part way: split the path
+            // with a new Node4 at the point where they differ.
+            Node4* branch = new Node4();
+            branch->prefix.assign(inner->prefix, 0, matched);
+            uint8_t edge = inner->prefix[matched];
+            inner->prefix.erase(0, matched + 1);
+            ArtNode* branchRef = branch;
+            addChild(branchRef, branch, edge, inner);
+            Leaf* leaf = new Leaf(keyValuePair);
+            if (depth + matched == key.size()) {
+                branch->terminal = leaf;
+            }
+            else {
+                addChild(branchRef, branch, key[depth + matched], leaf);
+            }
+            *ref = branch;
+            ++size_;
+            ++version_;
+            return std::make_pair(iterator(this, leaf), true);
+        }
+
+        depth += matched;
+        if (depth == key.size()) {
+            if (inner->terminal != NULL) {
+                inner->terminal->item.second = keyValuePair.second;
+                return std::make_pair(iterator(this, inner->terminal), false);
+            }
+            inner->terminal = new Leaf(keyValuePair);
+            ++size_;
+            ++version_;
+            return std::make_pair(iterator(this, inner->terminal), true);
+        }
+
+        ArtNode** child = findChild(inner, key[depth]);
+        if (child == NULL) {
+            Leaf* leaf = new Leaf(keyValuePair);
+            addChild(*ref, inner, key[depth], leaf);
+            ++size_;
+            ++version_;
+            return std::make_pair(iterator(this, leaf), true);
+        }
+        ref = child;
+        ++depth;
+    }
+}
+
+/**
+* Removes the key if present. The leaf's parent shrinks or collapses as
+* needed, so the tree stays path compressed.
+*/
+template<class Value>
+void AdaptiveRadixTree<Value>::remove(const std::string& key)
+{
+    ArtNode** ref = &root_;
+    ArtNode** parentRef = NULL;
+    size_t depth = 0;
+    while (*ref != NULL) {
+        ArtNode* node = *ref;
+        if (isLeaf(node)) {
+            if (asLeaf(node)->item.first != key) {
+                return;
+            }
+            if (parentRef == NULL) {
+                root_ = NULL;
+            }
+            else {
+                removeChild(*parentRef, asInner(*parentRef), key[depth - 1]);
+            }
+            destroyNode(node);
+            --size_;
+            ++version_;
+            return;
+        }
+
+        Inner* inner = asInner(node);
+        if (matchPrefix(inner, key, depth) != inner->prefix.size()) {
+            return;
+        }
+        depth += inner->prefix.size();
+        if (depth == key.size()) {
+            Leaf* leaf = inner->terminal;
+            if (leaf == NULL) {
+                return;
+            }
+            inner->terminal = NULL;
+            if (inner->type == NODE4) {
+                collapse(*ref, inner);
+            }
+            destroyNode(leaf);
+            --size_;
+            ++version_;
+            return;
+        }
+
+        ArtNode** child = findChild(inner, key[depth]);
+        if (child == NULL) {
+            return;
+        }
+        parentRef = ref;
+        ref = child;
+        ++depth;
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the AdaptiveRadixTree class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -6,7 +6,12 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
 #include "bst.h"
+#include "threadpool.h"
 
 struct KeyError { };
 
@@ -107,7 +112,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    return static_cast<AVLNode<Key, Value>*>(this->child_[0]);
 }
 
 /**
@@ -116,7 +121,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    return static_cast<AVLNode<Key, Value>*>(this->child_[1]);
 }
 
 
@@ -131,193 +136,354 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
-    virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
+    AVLTree();
+    AVLTree(const AVLTree& other);
+    AVLTree(AVLTree&& other);
+    virtual ~AVLTree();
+    AVLTree& operator=(const AVLTree& other);
+    AVLTree& operator=(AVLTree&& other);
+    virtual std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+        insert (const std::pair<const Key, Value> &new_item); // TODO
+    typename BinarySearchTree<Key, Value>::iterator insert(
+        typename BinarySearchTree<Key, Value>::iterator hint,
+        const std::pair<const Key, Value> &new_item);
     virtual void remove(const Key& key);  // TODO
+    using BinarySearchTree<Key, Value>::erase;
+    size_t erase(const Key& lo, const Key& hi);
+    virtual size_t remove_batch(const std::vector<Key>& keys);
+    size_t merge(const AVLTree& other);
+    template <typename Resolve>
+    size_t merge(const AVLTree& other, Resolve resolve);
+    virtual void compact();
+    virtual int height() const;
+
+    template <typename Fn>
+    void parallel_for_each(Fn fn, ThreadPool& pool = ThreadPool::shared()) const;
+    template <typename Fn>
+    void parallel_for_each(const Key& lo, const Key& hi, Fn fn,
+                           ThreadPool& pool = ThreadPool::shared()) const;
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(T identity, Map map, Combine combine,
+                      ThreadPool& pool = ThreadPool::shared()) const;
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(const Key& lo, const Key& hi, T identity, Map map, Combine combine,
+                      ThreadPool& pool = ThreadPool::shared()) const;
 protected:
+    // Subtrees at most this tall (up to 4095 nodes) are scanned by one task.
+    static const int PARALLEL_GRAIN_HEIGHT = 12;
+    // merge() inserts item by item when the other tree is at least this
+    // many levels shorter (roughly a tenth of the size or less).
+    static const int MERGE_FINGER_HEIGHT_GAP = 4;
+
+    typedef std::function<Value(const Key&, const Value&, const Value&)> Resolver;
+
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void destroyNode(Node<Key, Value>* node);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+    virtual size_t nodeSize() const;
+    virtual AVLNode<Key, Value>* constructNode(void* slot, const Key& key, const Value& value,
+                                               AVLNode<Key, Value>* parent);
+    void* allocateSlot();
+    void releaseSlot(void* slot);
+    bool inArena(const void* slot) const;
+    void swapArena(AVLTree& other);
+
+    // Hooks for subclasses that keep data about each subtree, such as
+    // MerkleAVLTree's hashes. AVLTree keeps none, so they do nothing here.
+    virtual void updateSubtree(AVLNode<Key, Value>* node);
+    virtual void updatePath(AVLNode<Key, Value>* node);
+    virtual void assignValue(AVLNode<Key, Value>* node, const Value& value);
+    virtual void relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to);
 
     // Add helper functions here
+    virtual std::pair<Node<Key, Value>*, bool> internalInsert(
+        const std::pair<const Key, Value> &new_item, bool overwrite);
+    AVLNode<Key, Value>* attachNode(AVLNode<Key, Value>* parent, bool right,
+                                    const std::pair<const Key, Value> &new_item);
+    void insertFix(AVLNode<Key, Value>* leaf);
+    void replaceChild(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* oldChild,
+                      AVLNode<Key, Value>* newChild);
+    AVLNode<Key, Value>* rotateLeft(AVLNode<Key, Value>* x);
+    AVLNode<Key, Value>* rotateRight(AVLNode<Key, Value>* x);
+    AVLNode<Key, Value>* rebalance(AVLNode<Key, Value>* z);
+    static int subtreeHeight(AVLNode<Key, Value>* node);
+    static int childHeight(AVLNode<Key, Value>* node, int height, int dir);
+    template <typename Fn>
+    static void forEachSequential(AVLNode<Key, Value>* node, const Key* lo, const Key* hi, Fn& fn);
+    template <typename Fn>
+    void forEachParallel(AVLNode<Key, Value>* node, int height, const Key* lo, const Key* hi,
+                         Fn& fn, ThreadPool::TaskGroup& group) const;
+    template <typename T, typename Map, typename Combine>
+    T reduceParallel(AVLNode<Key, Value>* node, int height, const Key* lo, const Key* hi,
+                     const T& identity, Map& map, Combine& combine, ThreadPool& pool) const;
+    AVLNode<Key, Value>* linkNode(AVLNode<Key, Value>* node, AVLNode<Key, Value>* left, int leftHeight,
+                                         AVLNode<Key, Value>* right, int rightHeight, int& height);
+    AVLNode<Key, Value>* linkSide(AVLNode<Key, Value>* node, AVLNode<Key, Value>* outer, int outerHeight,
+                                         AVLNode<Key, Value>* inner, int innerHeight, int dir, int& height);
+    AVLNode<Key, Value>* joinTrees(AVLNode<Key, Value>* left, int leftHeight, AVLNode<Key, Value>* mid,
+                                          AVLNode<Key, Value>* right, int rightHeight, int& height);
+    AVLNode<Key, Value>* joinTaller(AVLNode<Key, Value>* tall, int tallHeight, AVLNode<Key, Value>* mid,
+                                           AVLNode<Key, Value>* shorter, int shorterHeight, int dir, int& height);
+    void splitTree(AVLNode<Key, Value>* node, int height, const Key& key,
+                          AVLNode<Key, Value>*& less, int& lessHeight,
+                          AVLNode<Key, Value>*& rest, int& restHeight);
+    AVLNode<Key, Value>* splitLast(AVLNode<Key, Value>* node, int height,
+                                          AVLNode<Key, Value>*& last, int& restHeight);
+    AVLNode<Key, Value>* joinPair(AVLNode<Key, Value>* left, int leftHeight,
+                                         AVLNode<Key, Value>* right, int rightHeight, int& height);
+    AVLNode<Key, Value>* removeSorted(AVLNode<Key, Value>* node, int height, const Key* first, const Key* last,
+                                      int& newHeight, size_t& removed);
+    size_t destroySubtree(AVLNode<Key, Value>* node);
+    virtual size_t mergeWith(const AVLTree& other, const Resolver& resolve);
+    void mergeFinger(const AVLTree& other, const Resolver& resolve, size_t& added);
+    void mergeLinear(const AVLTree& other, const Resolver& resolve, size_t& added);
+    AVLNode<Key, Value>* buildBalanced(AVLNode<Key, Value>* const* nodes, size_t count, int& height);
+    void setRoot(AVLNode<Key, Value>* root);
+    static void vebLayout(AVLNode<Key, Value>* node, int levels, std::vector<AVLNode<Key, Value>*>& order);
+    static void collectAtDepth(AVLNode<Key, Value>* node, int depth, std::vector<AVLNode<Key, Value>*>& out);
+    static bool inBlock(const void* slot, const char* block, size_t bytes);
+
+    // compact() moves the nodes into one block of nodeSize() slots. Nodes
+    // in it are destroyed in place and their slots reused by later
+    // insertions.
+    char* arena_;
+    size_t arenaBytes_;
+    std::vector<void*> arenaFree_;
+    char* retiring_;   // the previous block, while compacting
+    size_t retiringBytes_;
+};
+
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree() :
+    arena_(NULL), arenaBytes_(0), retiring_(NULL), retiringBytes_(0)
+{
 
+}
 
-};
+/**
+* Deep copy in O(n), balances included. The base class is default
+* constructed and the clone done here, where createNode already makes
+* AVLNodes (in the base constructor it would still make plain Nodes).
+*/
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree(const AVLTree<Key, Value>& other) :
+    BinarySearchTree<Key, Value>(),
+    arena_(NULL), arenaBytes_(0), retiring_(NULL), retiringBytes_(0)
+{
+    this->cloneFrom(other);
+}
+
+/**
+* Takes over other's nodes, and the compacted block they may live in,
+* in O(1).
+*/
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree(AVLTree<Key, Value>&& other) :
+    BinarySearchTree<Key, Value>(std::move(other)),
+    arena_(NULL), arenaBytes_(0), retiring_(NULL), retiringBytes_(0)
+{
+    swapArena(other);
+}
+
+template<class Key, class Value>
+AVLTree<Key, Value>& AVLTree<Key, Value>::operator=(const AVLTree<Key, Value>& other)
+{
+    BinarySearchTree<Key, Value>::operator=(other);
+    return *this;
+}
+
+/**
+* The current nodes are freed first, so the block this tree gives to
+* other in exchange holds no live nodes.
+*/
+template<class Key, class Value>
+AVLTree<Key, Value>& AVLTree<Key, Value>::operator=(AVLTree<Key, Value>&& other)
+{
+    if (this != &other) {
+        BinarySearchTree<Key, Value>::operator=(std::move(other));
+        swapArena(other);
+    }
+    return *this;
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::swapArena(AVLTree<Key, Value>& other)
+{
+    std::swap(arena_, other.arena_);
+    std::swap(arenaBytes_, other.arenaBytes_);
+    arenaFree_.swap(other.arenaFree_);
+}
+
+/**
+* Copies carry the source's balance along with the item.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    AVLNode<Key, Value>* copy = static_cast<AVLNode<Key, Value>*>(
+        this->createNode(source->getKey(), source->getValue(), parent));
+    copy->setBalance(static_cast<const AVLNode<Key, Value>*>(source)->getBalance());
+    return copy;
+}
+
+/**
+* Clears here rather than leaving it to ~BinarySearchTree, which would
+* free the nodes with its own destroyNode and so miss the arena.
+*/
+template<class Key, class Value>
+AVLTree<Key, Value>::~AVLTree()
+{
+    this->clear();
+    ::operator delete(arena_);
+}
 
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
  */
 template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 {
-    if (this->root_ == nullptr){
-        this->root_ = new AVLNode<Key, Value>(new_item.first, new_item.second, nullptr);
-        return; 
+    std::pair<Node<Key, Value>*, bool> result = internalInsert(new_item, true);
+    return std::make_pair(this->makeIterator(result.first), result.second);
+}
+
+/**
+* Inserts new_item using hint as a guess for where it belongs: if the key falls
+* between hint's predecessor and hint (or between hint and its successor) the node
+* is attached there without descending from the root. Passing end() as the hint
+* targets the position after the largest key. A wrong hint costs two comparisons
+* before falling back to an ordinary insert. Returns an iterator to the item.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+AVLTree<Key, Value>::insert(typename BinarySearchTree<Key, Value>::iterator hint,
+                            const std::pair<const Key, Value> &new_item)
+{
+    AVLNode<Key, Value>* h = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(hint));
+    const Key& key = new_item.first;
+
+    if (h == nullptr) {
+        // internalInsert already tries the largest node first
+        return this->makeIterator(internalInsert(new_item, true).first);
     }
 
-    AVLNode<Key, Value>* active = static_cast<AVLNode<Key, Value>*>(this->root_);
-    Key aKey = new_item.first; 
-    AVLNode<Key, Value>* activeTraverser; 
-    while (true){
-        if (active->getLeft() == nullptr && aKey < active->getKey()){
-            active->setLeft(new AVLNode<Key, Value>(new_item.first, new_item.second, active)); 
-            activeTraverser = active->getLeft(); 
-            break;
+    if (key < h->getKey()) {
+        AVLNode<Key, Value>* pred = static_cast<AVLNode<Key, Value>*>(this->predecessor(h));
+        if (pred == nullptr || pred->getKey() < key) {
+            if (h->getLeft() == nullptr) {
+                return this->makeIterator(attachNode(h, false, new_item));
+            }
+            return this->makeIterator(attachNode(pred, true, new_item)); // pred is the max of h's left subtree
         }
-        else if (active->getRight() == nullptr && aKey > active->getKey()){
-            active->setRight(new AVLNode<Key, Value>(new_item.first, new_item.second, active)); 
-            activeTraverser = active->getRight(); 
-            break;
+    }
+    else if (h->getKey() < key) {
+        AVLNode<Key, Value>* succ = static_cast<AVLNode<Key, Value>*>(this->successor(h));
+        if (succ == nullptr || key < succ->getKey()) {
+            if (h->getRight() == nullptr) {
+                return this->makeIterator(attachNode(h, true, new_item));
+            }
+            return this->makeIterator(attachNode(succ, false, new_item)); // succ is the min of h's right subtree
         }
-        else if (active->getLeft() != nullptr && aKey < active->getKey()){
-            active = active->getLeft(); 
+    }
+    else {
+        assignValue(h, new_item.second);
+        updatePath(h);
+        return hint;
+    }
+    return this->makeIterator(internalInsert(new_item, true).first);
+}
+
+/**
+* Inserts new_item (or finds its key, replacing the value if overwrite is set)
+* and returns the node plus whether it is new. Keys larger than the current
+* maximum are appended to the cached rightmost node after a single comparison,
+* so monotonically increasing streams skip the descent entirely.
+*/
+template<class Key, class Value>
+std::pair<Node<Key, Value>*, bool>
+AVLTree<Key, Value>::internalInsert(const std::pair<const Key, Value> &new_item, bool overwrite)
+{
+    if (this->root_ == nullptr){
+        this->root_ = this->createNode(new_item.first, new_item.second, nullptr);
+        this->leftmost_ = this->root_;
+        this->rightmost_ = this->root_;
+        return std::make_pair(this->root_, true); 
+    }
+
+    AVLNode<Key, Value>* rightmost = static_cast<AVLNode<Key, Value>*>(this->rightmost_);
+    if (rightmost->getKey() < new_item.first) {
+        return std::make_pair(attachNode(rightmost, true, new_item), true);
+    }
+
+    int dir;
+    AVLNode<Key, Value>* active = static_cast<AVLNode<Key, Value>*>(this->descend(new_item.first, dir));
+    if (dir < 0) {
+        if (overwrite) {
+            assignValue(active, new_item.second);
+            updatePath(active);
         }
-        else if (active->getRight() != nullptr && aKey > active->getKey()){
-            active = active->getRight(); 
+        return std::make_pair(active, false);
+    }
+    return std::make_pair(attachNode(active, dir == 1, new_item), true);
+}
+
+/**
+* Hangs a new node for new_item off the empty left or right link of parent,
+* keeps leftmost_/rightmost_ current and rebalances. Returns the new node.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::attachNode(AVLNode<Key, Value>* parent, bool right,
+                                                     const std::pair<const Key, Value> &new_item)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(
+        this->createNode(new_item.first, new_item.second, parent));
+    if (right) {
+        parent->setRight(node);
+        if (parent == this->rightmost_) {
+            this->rightmost_ = node;
         }
-        else {
-            active->setValue(new_item.second);
-            return;
+    }
+    else {
+        parent->setLeft(node);
+        if (parent == this->leftmost_) {
+            this->leftmost_ = node;
         }
     }
-    
-    AVLNode<Key, Value>* child = activeTraverser;
+    insertFix(node);
+    updatePath(node);
+    return node;
+}
+
+/**
+* Walks up from a freshly attached leaf updating balances, and performs
+* at most one (single or double) rotation.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* leaf)
+{
+    AVLNode<Key, Value>* child = leaf;
     AVLNode<Key, Value>* parent = child->getParent();
 
     while (parent != nullptr) {
         
         if (parent->getLeft() == child) {
-            parent->setBalance(parent->getBalance() - 1);
+            parent->updateBalance(-1);
         } else {
-            parent->setBalance(parent->getBalance() + 1);
+            parent->updateBalance(1);
         }
 
         if (parent->getBalance() == 0) {
             break; 
         }
 
-        AVLNode<Key, Value>* activeTraverser = parent;
-
-        if (activeTraverser->getBalance() == 2){ // heavier right side
-            int rChild = activeTraverser->getRight()->getBalance(); 
-            if (rChild == 1) { // RR rotation
-                AVLNode<Key, Value>* child = activeTraverser->getRight();
-                activeTraverser->setRight(child->getLeft());
-                if (activeTraverser->getRight() != nullptr){
-                    activeTraverser->getRight()->setParent(activeTraverser);
-                }
-                child->setLeft(activeTraverser); 
-
-                if(activeTraverser->getParent() == nullptr){
-                    child->setParent(nullptr);
-                    this->root_ = child;
-                }
-                else {
-                    child->setParent(activeTraverser->getParent());
-                    if (child->getParent()->getLeft() == activeTraverser){
-                        child->getParent()->setLeft(child);
-                    }
-                    else {
-                        child->getParent()->setRight(child);
-                    }
-                }
-                activeTraverser->setParent(child);
-                activeTraverser->setBalance(0);
-                child->setBalance(0); 
-            }
-            else { // RL rotation
-                AVLNode<Key, Value>* z = activeTraverser;
-                AVLNode<Key, Value>* c = z->getRight();
-                AVLNode<Key, Value>* g = c->getLeft();
-                
-                AVLNode<Key, Value>* t2 = g->getLeft();
-                AVLNode<Key, Value>* t3 = g->getRight();
-
-                g->setLeft(z);
-                g->setRight(c);
-                z->setRight(t2);
-                c->setLeft(t3); 
-
-                if (t2 != nullptr) { t2->setParent(z); }
-                if (t3 != nullptr) { t3->setParent(c); }
-
-                g->setParent(z->getParent());
-                if (g->getParent() == nullptr) {
-                    this->root_ = g;
-                } else {
-                    if (g->getParent()->getLeft() == z) g->getParent()->setLeft(g);
-                    else g->getParent()->setRight(g);
-                }
-                
-                z->setParent(g);
-                c->setParent(g);
-
-                if (g->getBalance() == -1) { z->setBalance(0); c->setBalance(1); }
-                else if (g->getBalance() == 1) { z->setBalance(-1); c->setBalance(0); }
-                else { z->setBalance(0); c->setBalance(0); }
-                g->setBalance(0);
-            }
+        if (parent->getBalance() == 2 || parent->getBalance() == -2) {
+            rebalance(parent);
             break; // A rotation always finishes the balancing for insert
         }
-        else if (activeTraverser->getBalance() == -2){ // heavier left side
-            int lChild = activeTraverser->getLeft()->getBalance(); 
-            if (lChild == 1) { // LR rotation
-                AVLNode<Key, Value>* z = activeTraverser;
-                AVLNode<Key, Value>* c = z->getLeft();
-                AVLNode<Key, Value>* g = c->getRight();
-                
-                AVLNode<Key, Value>* t2 = g->getLeft();
-                AVLNode<Key, Value>* t3 = g->getRight();
-
-                g->setLeft(c);
-                g->setRight(z);
-                c->setRight(t2);
-                z->setLeft(t3); 
-
-                if (t2 != nullptr) { t2->setParent(c); }
-                if (t3 != nullptr) { t3->setParent(z); }
-
-                g->setParent(z->getParent());
-                if (g->getParent() == nullptr) {
-                    this->root_ = g;
-                } else {
-                    if (g->getParent()->getLeft() == z) g->getParent()->setLeft(g);
-                    else g->getParent()->setRight(g);
-                }
-
-                z->setParent(g);
-                c->setParent(g);
-
-                if (g->getBalance() == 1) { z->setBalance(0); c->setBalance(-1); }
-                else if (g->getBalance() == -1) { z->setBalance(1); c->setBalance(0); }
-                else { z->setBalance(0); c->setBalance(0); }
-                g->setBalance(0);
-            }
-            else { // LL rotation
-                AVLNode<Key, Value>* child = activeTraverser->getLeft();
-                activeTraverser->setLeft(child->getRight());
-                if (activeTraverser->getLeft() != nullptr){
-                    activeTraverser->getLeft()->setParent(activeTraverser);
-                }
-                child->setRight(activeTraverser); 
-
-                if(activeTraverser->getParent() == nullptr){
-                    child->setParent(nullptr);
-                    this->root_ = child;
-                }
-                else {
-                    child->setParent(activeTraverser->getParent());
-                    if (child->getParent()->getLeft() == activeTraverser){
-                        child->getParent()->setLeft(child);
-                    }
-                    else {
-                        child->getParent()->setRight(child);
-                    }
-                }
-                activeTraverser->setParent(child);
-                activeTraverser->setBalance(0);
-                child->setBalance(0); 
-            }
-            break;
-        }
 
         child = parent;
         parent = parent->getParent();
@@ -331,12 +497,29 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 template<class Key, class Value>
 void AVLTree<Key, Value>:: remove(const Key& key)
 {
-     AVLNode<Key, Value>* foundKey = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
+    removeNode(this->internalFind(key));
+}
+
+/**
+* Unlinks and deletes a node already located in the tree, then walks back
+* up rebalancing.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNode(Node<Key, Value>* node)
+{
+    AVLNode<Key, Value>* foundKey = static_cast<AVLNode<Key, Value>*>(node);
 
     if (foundKey == nullptr) {
         return;
     }
 
+    if (foundKey == this->leftmost_) { // at most one child, so never swapped
+        this->leftmost_ = this->successor(foundKey);
+    }
+    if (foundKey == this->rightmost_) {
+        this->rightmost_ = this->predecessor(foundKey);
+    }
+
     if (foundKey->getLeft() != nullptr && foundKey->getRight() != nullptr) {
         AVLNode<Key, Value>* pred = static_cast<AVLNode<Key, Value>*>(this->predecessor(foundKey));
         this->nodeSwap(foundKey, pred);
@@ -369,7 +552,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         child->setParent(parent);
     }
 
-    delete foundKey;
+    this->destroyNode(foundKey);
 
     AVLNode<Key, Value>* curr = parent;
     while (curr != nullptr) {
@@ -379,128 +562,10 @@ void AVLTree<Key, Value>:: remove(const Key& key)
             break; 
         }
 
-        if (curr->getBalance() == 2) { // Right-heavy
-            AVLNode<Key, Value>* c = curr->getRight(); // child
-            
-            if (c->getBalance() == 1 || c->getBalance() == 0) {
-                AVLNode<Key, Value>* z = curr;
-                z->setRight(c->getLeft());
-                if (z->getRight() != nullptr){
-                    z->getRight()->setParent(z);
-                }
-                c->setLeft(z); 
-
-                if(z->getParent() == nullptr){
-                    c->setParent(nullptr);
-                    this->root_ = c;
-                }
-                else {
-                    c->setParent(z->getParent());
-                    if (c->getParent()->getLeft() == z){
-                        c->getParent()->setLeft(c);
-                    }
-                    else {
-                        c->getParent()->setRight(c);
-                    }
-                }
-                z->setParent(c);
-                
-                if (c->getBalance() == 0) {
-                    z->setBalance(1);
-                    c->setBalance(-1);
-                    break; // Height stabilized
-                } else {
-                    z->setBalance(0);
-                    c->setBalance(0);
-                }
-            } 
-            else { // RL Case
-                AVLNode<Key, Value>* z = curr;
-                AVLNode<Key, Value>* g = c->getLeft(); // grandchild
-
-                c->setLeft(g->getRight());
-                if (c->getLeft() != nullptr) { c->getLeft()->setParent(c); }
-                g->setRight(c);
-                c->setParent(g);
-
-                z->setRight(g);
-                g->setParent(z); 
-
-                g->setParent(z->getParent());
-                if (g->getParent() == nullptr) { this->root_ = g; }
-                else {
-                    if (g->getParent()->getLeft() == z) g->getParent()->setLeft(g);
-                    else g->getParent()->setRight(g);
-                }
-                z->setParent(g);
-
-                if (g->getBalance() == -1) { z->setBalance(0); c->setBalance(1); }
-                else if (g->getBalance() == 1) { z->setBalance(-1); c->setBalance(0); }
-                else { z->setBalance(0); c->setBalance(0); }
-                g->setBalance(0);
-            }
-        } 
-        else if (curr->getBalance() == -2) { // Left-heavy
-            AVLNode<Key, Value>* c = curr->getLeft(); // child
-            
-            // LL Case (or L0 case)
-            if (c->getBalance() == -1 || c->getBalance() == 0) {
-                AVLNode<Key, Value>* z = curr;
-
-                z->setLeft(c->getRight());
-                if (z->getLeft() != nullptr){
-                    z->getLeft()->setParent(z);
-                }
-                c->setRight(z); 
-
-                if(z->getParent() == nullptr){
-                    c->setParent(nullptr);
-                    this->root_ = c;
-                }
-                else {
-                    c->setParent(z->getParent());
-                    if (z->getParent()->getLeft() == z){
-                        c->getParent()->setLeft(c);
-                    }
-                    else {
-                        c->getParent()->setRight(c);
-                    }
-                }
-                z->setParent(c);
-
-                if (c->getBalance() == 0) {
-                    z->setBalance(-1);
-                    c->setBalance(1);
-                    break; // Height stabilized
-                } else {
-                    z->setBalance(0);
-                    c->setBalance(0);
-                }
-            } 
-            else { // LR Case (c->getBalance() == 1)
-                AVLNode<Key, Value>* z = curr;
-                AVLNode<Key, Value>* g = c->getRight(); // grandchild
-
-                c->setRight(g->getLeft());
-                if (c->getRight() != nullptr) { c->getRight()->setParent(c); }
-                g->setLeft(c);
-                c->setParent(g);
-
-                z->setLeft(g);
-                g->setParent(z);
-
-                g->setParent(z->getParent());
-                if (g->getParent() == nullptr) { this->root_ = g; }
-                else {
-                    if (g->getParent()->getLeft() == z) g->getParent()->setLeft(g);
-                    else g->getParent()->setRight(g);
-                }
-                z->setParent(g);
-
-                if (g->getBalance() == 1) { z->setBalance(0); c->setBalance(-1); }
-                else if (g->getBalance() == -1) { z->setBalance(1); c->setBalance(0); }
-                else { z->setBalance(0); c->setBalance(0); }
-                g->setBalance(0);
+        if (curr->getBalance() == 2 || curr->getBalance() == -2) {
+            curr = rebalance(curr);
+            if (curr->getBalance() != 0) {
+                break; // Height stabilized
             }
         }
 
@@ -514,6 +579,357 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         }
         curr = nextParent;
     }
+    updatePath(parent);
+    this->afterRemoval();
+}
+
+/**
+* AVL trees are built from AVLNodes; the rest of the tree code relies on it.
+* The node is built by constructNode in a slot from allocateSlot, so a
+* subclass with its own node type overrides those two hooks rather than
+* this one.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    void* slot = allocateSlot();
+    try {
+        return constructNode(slot, key, value, static_cast<AVLNode<Key, Value>*>(parent));
+    }
+    catch (...) {
+        releaseSlot(slot);
+        throw;
+    }
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::destroyNode(Node<Key, Value>* node)
+{
+    node->~Node<Key, Value>();
+    releaseSlot(node);
+}
+
+/**
+* The size of the nodes constructNode builds. Every slot, in the compacted
+* block or on the heap, is this big.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::nodeSize() const
+{
+    return sizeof(AVLNode<Key, Value>);
+}
+
+/**
+* Builds a node in nodeSize() bytes of raw memory at slot. createNode
+* and compact make every node through here.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::constructNode(void* slot, const Key& key, const Value& value,
+                                                        AVLNode<Key, Value>* parent)
+{
+    return new (slot) AVLNode<Key, Value>(key, value, parent);
+}
+
+/**
+* Returns memory for one node: a free slot in the compacted block if
+* there is one, or else a new one from the heap.
+*/
+template<class Key, class Value>
+void* AVLTree<Key, Value>::allocateSlot()
+{
+    if (arenaFree_.empty()) {
+        return ::operator new(nodeSize());
+    }
+    void* slot = arenaFree_.back();
+    arenaFree_.pop_back();
+    return slot;
+}
+
+/**
+* Takes back the memory of a node that has been destroyed. Slots in the
+* compacted block are kept for reuse, those in the block being retired
+* go with it, and the rest return to the heap.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::releaseSlot(void* slot)
+{
+    if (inBlock(slot, arena_, arenaBytes_)) {
+        arenaFree_.push_back(slot);
+    }
+    else if (!inBlock(slot, retiring_, retiringBytes_)) {
+        ::operator delete(slot);
+    }
+}
+
+/**
+* Whether slot lies in the compacted block, or in the one compact() is
+* retiring, rather than on the heap.
+*/
+template<class Key, class Value>
+bool AVLTree<Key, Value>::inArena(const void* slot) const
+{
+    return inBlock(slot, arena_, arenaBytes_) || inBlock(slot, retiring_, retiringBytes_);
+}
+
+/**
+* Called with a node whose children, or the items below it, have just
+* changed, after its descendants have been updated.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::updateSubtree(AVLNode<Key, Value>*)
+{
+
+}
+
+/**
+* Called once an insertion, removal or value change below node has been
+* completed and rebalanced. Every node whose items changed is then node or
+* one of its ancestors; the nodes that rotations moved off that path have
+* been updated by updateSubtree. A subclass that keeps subtree data
+* updates the path to the root here, bottom-up.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::updatePath(AVLNode<Key, Value>*)
+{
+
+}
+
+/**
+* Every value AVLTree itself writes goes through here, so a subclass can
+* keep data derived from the value up to date.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::assignValue(AVLNode<Key, Value>* node, const Value& value)
+{
+    node->setValue(value);
+}
+
+/**
+* Called by compact() for each node it moves, after from's item and
+* balance have been copied to to and to has been linked in. Until compact
+* returns, the parent link of from, and of every other node being moved,
+* points at that node's copy. The copy stands in for from: it is neither
+* created nor destroyed through createNode and destroyNode, so a subclass
+* that tracks nodes by address or keeps extra data in them carries it
+* over here.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::relocateNode(AVLNode<Key, Value>*, AVLNode<Key, Value>*)
+{
+
+}
+
+template<class Key, class Value>
+bool AVLTree<Key, Value>::inBlock(const void* slot, const char* block, size_t bytes)
+{
+    std::less_equal<const void*> le;
+    std::less<const void*> lt;
+    return block != NULL && le(block, slot) && lt(slot, block + bytes);
+}
+
+/**
+* Appends the subtree's top `levels` levels to order in van Emde Boas
+* order: the top half of the levels first, then each subtree hanging below
+* it, each laid out the same way recursively.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::vebLayout(AVLNode<Key, Value>* node, int levels, std::vector<AVLNode<Key, Value>*>& order)
+{
+    if (node == NULL || levels <= 0) {
+        return;
+    }
+    if (levels == 1) {
+        order.push_back(node);
+        return;
+    }
+    int top = levels / 2;
+    vebLayout(node, top, order);
+    std::vector<AVLNode<Key, Value>*> bottoms;
+    collectAtDepth(node, top, bottoms);
+    for (size_t i = 0; i < bottoms.size(); ++i) {
+        vebLayout(bottoms[i], levels - top, order);
+    }
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::collectAtDepth(AVLNode<Key, Value>* node, int depth, std::vector<AVLNode<Key, Value>*>& out)
+{
+    if (node == NULL) {
+        return;
+    }
+    if (depth == 0) {
+        out.push_back(node);
+        return;
+    }
+    collectAtDepth(node->getLeft(), depth - 1, out);
+    collectAtDepth(node->getRight(), depth - 1, out);
+}
+
+/**
+* Moves every node into one contiguous block laid out in van Emde Boas
+* order, so that a root-to-leaf search touches O(log_B n) cache lines and
+* pages for any block size B. The items are copied into the new nodes and
+* the old ones freed, which invalidates iterators. The copies are built by
+* constructNode, and the move is reported through relocateNode rather than
+* createNode and destroyNode, so subclasses do not see it as an insertion
+* and a removal. The tree stays fully
+* mutable: removals free slots in the block and insertions reuse them
+* before allocating elsewhere. Runs in O(n log log n).
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::compact()
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    std::vector<AVLNode<Key, Value>*> order;
+    vebLayout(root, subtreeHeight(root), order);
+
+    size_t size = nodeSize();
+    retiring_ = arena_;
+    retiringBytes_ = arenaBytes_;
+    arenaBytes_ = order.size() * size;
+    arena_ = order.empty() ? NULL : static_cast<char*>(::operator new(arenaBytes_));
+    arenaFree_.clear();
+
+    // Copy each node into its slot and leave a forwarding pointer to the
+    // copy in the old node's parent link, which is no longer needed.
+    for (size_t i = 0; i < order.size(); ++i) {
+        AVLNode<Key, Value>* old = order[i];
+        AVLNode<Key, Value>* copy = constructNode(arena_ + i * size, old->getKey(), old->getValue(), NULL);
+        copy->setBalance(old->getBalance());
+        old->setParent(copy);
+    }
+
+    // Rebuild the links from the old child links; parents follow.
+    for (size_t i = 0; i < order.size(); ++i) {
+        AVLNode<Key, Value>* copy = order[i]->getParent();
+        AVLNode<Key, Value>* left = order[i]->getLeft();
+        AVLNode<Key, Value>* right = order[i]->getRight();
+        copy->setLeft(left != NULL ? left->getParent() : NULL);
+        copy->setRight(right != NULL ? right->getParent() : NULL);
+        if (left != NULL) {
+            left->getParent()->setParent(copy);
+        }
+        if (right != NULL) {
+            right->getParent()->setParent(copy);
+        }
+        relocateNode(order[i], copy);
+    }
+    if (root != NULL) {
+        this->root_ = root->getParent();
+        this->leftmost_ = this->leftmost_->getParent();
+        this->rightmost_ = this->rightmost_->getParent();
+    }
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i]->setLeft(NULL);
+        order[i]->setRight(NULL);
+        AVLTree<Key, Value>::destroyNode(order[i]);
+    }
+    ::operator delete(retiring_);
+    retiring_ = NULL;
+    retiringBytes_ = 0;
+}
+
+/**
+* Points parent's link that referred to oldChild at newChild instead
+* (or the root, if parent is NULL).
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::replaceChild(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* oldChild,
+                                       AVLNode<Key, Value>* newChild)
+{
+    if (parent == nullptr) {
+        this->root_ = newChild;
+    }
+    else if (parent->getLeft() == oldChild) {
+        parent->setLeft(newChild);
+    }
+    else {
+        parent->setRight(newChild);
+    }
+}
+
+/**
+* Rotates x's right child up into x's place. Returns the new subtree root.
+* Balances are left for the caller to fix.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* x)
+{
+    AVLNode<Key, Value>* y = x->getRight();
+    AVLNode<Key, Value>* t = y->getLeft();
+    x->setRight(t);
+    if (t != nullptr) { t->setParent(x); }
+    y->setParent(x->getParent());
+    replaceChild(x->getParent(), x, y);
+    y->setLeft(x);
+    x->setParent(y);
+    updateSubtree(x);
+    updateSubtree(y);
+    return y;
+}
+
+/**
+* Mirror image of rotateLeft.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* x)
+{
+    AVLNode<Key, Value>* y = x->getLeft();
+    AVLNode<Key, Value>* t = y->getRight();
+    x->setLeft(t);
+    if (t != nullptr) { t->setParent(x); }
+    y->setParent(x->getParent());
+    replaceChild(x->getParent(), x, y);
+    y->setRight(x);
+    x->setParent(y);
+    updateSubtree(x);
+    updateSubtree(y);
+    return y;
+}
+
+/**
+* Restores the AVL property at z, whose balance has reached +2 or -2, with a
+* single or double rotation. Returns the root of the rebalanced subtree; its
+* balance is 0 iff the subtree got shorter.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::rebalance(AVLNode<Key, Value>* z)
+{
+    if (z->getBalance() == 2) { // heavier right side
+        AVLNode<Key, Value>* c = z->getRight();
+        if (c->getBalance() >= 0) { // RR rotation (c is even only during removal)
+            rotateLeft(z);
+            if (c->getBalance() == 0) { z->setBalance(1); c->setBalance(-1); }
+            else { z->setBalance(0); c->setBalance(0); }
+            return c;
+        }
+        AVLNode<Key, Value>* g = c->getLeft(); // RL rotation
+        rotateRight(c);
+        rotateLeft(z);
+        if (g->getBalance() == -1) { z->setBalance(0); c->setBalance(1); }
+        else if (g->getBalance() == 1) { z->setBalance(-1); c->setBalance(0); }
+        else { z->setBalance(0); c->setBalance(0); }
+        g->setBalance(0);
+        return g;
+    }
+    else { // heavier left side
+        AVLNode<Key, Value>* c = z->getLeft();
+        if (c->getBalance() <= 0) { // LL rotation
+            rotateRight(z);
+            if (c->getBalance() == 0) { z->setBalance(-1); c->setBalance(1); }
+            else { z->setBalance(0); c->setBalance(0); }
+            return c;
+        }
+        AVLNode<Key, Value>* g = c->getRight(); // LR rotation
+        rotateLeft(c);
+        rotateRight(z);
+        if (g->getBalance() == 1) { z->setBalance(0); c->setBalance(-1); }
+        else if (g->getBalance() == -1) { z->setBalance(1); c->setBalance(0); }
+        else { z->setBalance(0); c->setBalance(0); }
+        g->setBalance(0);
+        return g;
+    }
 }
 
 template<class Key, class Value>
@@ -525,5 +941,675 @@ void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>*
     n2->setBalance(tempB);
 }
 
+/**
+* Returns the height of the subtree (0 for NULL) in O(log n) by following
+* the taller child, which the balance identifies.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::subtreeHeight(AVLNode<Key, Value>* node)
+{
+    int height = 0;
+    while (node != NULL) {
+        ++height;
+        node = node->getBalance() > 0 ? node->getRight() : node->getLeft();
+    }
+    return height;
+}
+
+/**
+* The tree's height in O(log n), from the balances.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::height() const
+{
+    return subtreeHeight(static_cast<AVLNode<Key, Value>*>(this->root_));
+}
+
+/**
+* Returns the height of node's left (dir 0) or right (dir 1) subtree given
+* node's own height: one less, or two less on the shorter side.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::childHeight(AVLNode<Key, Value>* node, int height, int dir)
+{
+    int shorter = dir == 0 ? node->getBalance() > 0 : node->getBalance() < 0;
+    return height - 1 - shorter;
+}
+
+/**
+* Calls fn on every item in the subtree whose key is within [*lo, *hi),
+* in key order. A NULL bound means that side is unbounded.
+*/
+template<class Key, class Value>
+template<typename Fn>
+void AVLTree<Key, Value>::forEachSequential(AVLNode<Key, Value>* node, const Key* lo, const Key* hi, Fn& fn)
+{
+    while (node != NULL) {
+        if (lo != NULL && node->getKey() < *lo) {
+            node = node->getRight();
+        }
+        else if (hi != NULL && !(node->getKey() < *hi)) {
+            node = node->getLeft();
+        }
+        else {
+            // Everything left of an in-range node is below hi, and
+            // everything right of it is at or above lo.
+            forEachSequential(node->getLeft(), lo, NULL, fn);
+            const std::pair<const Key, Value>& item = node->getItem();
+            fn(item);
+            lo = NULL;
+            node = node->getRight();
+        }
+    }
+}
+
+/**
+* Splits the subtree for parallel_for_each. Above the grain height the
+* right part of each in-range node is handed to the pool while this thread
+* carries on down the left, so every split roughly halves the work.
+*/
+template<class Key, class Value>
+template<typename Fn>
+void AVLTree<Key, Value>::forEachParallel(AVLNode<Key, Value>* node, int height, const Key* lo, const Key* hi,
+                                          Fn& fn, ThreadPool::TaskGroup& group) const
+{
+    while (node != NULL && height > PARALLEL_GRAIN_HEIGHT) {
+        if (lo != NULL && node->getKey() < *lo) {
+            height = childHeight(node, height, 1);
+            node = node->getRight();
+        }
+        else if (hi != NULL && !(node->getKey() < *hi)) {
+            height = childHeight(node, height, 0);
+            node = node->getLeft();
+        }
+        else {
+            AVLNode<Key, Value>* right = node->getRight();
+            int rightHeight = childHeight(node, height, 1);
+            if (right != NULL) {
+                group.run([this, right, rightHeight, hi, &fn, &group]() {
+                    forEachParallel(right, rightHeight, NULL, hi, fn, group);
+                });
+            }
+            const std::pair<const Key, Value>& item = node->getItem();
+            fn(item);
+            hi = NULL;
+            height = childHeight(node, height, 0);
+            node = node->getLeft();
+        }
+    }
+    forEachSequential(node, lo, hi, fn);
+}
+
+/**
+* Reduces the subtree for parallel_reduce, combining results in key order:
+* the pool reduces the right part while this thread reduces the left, then
+* left, node and right are combined.
+*/
+template<class Key, class Value>
+template<typename T, typename Map, typename Combine>
+T AVLTree<Key, Value>::reduceParallel(AVLNode<Key, Value>* node, int height, const Key* lo, const Key* hi,
+                                      const T& identity, Map& map, Combine& combine, ThreadPool& pool) const
+{
+    while (node != NULL && height > PARALLEL_GRAIN_HEIGHT) {
+        if (lo != NULL && node->getKey() < *lo) {
+            height = childHeight(node, height, 1);
+            node = node->getRight();
+        }
+        else if (hi != NULL && !(node->getKey() < *hi)) {
+            height = childHeight(node, height, 0);
+            node = node->getLeft();
+        }
+        else {
+            AVLNode<Key, Value>* right = node->getRight();
+            int rightHeight = childHeight(node, height, 1);
+            T rightResult = identity;
+            ThreadPool::TaskGroup group(pool);
+            group.run([&]() {
+                rightResult = reduceParallel(right, rightHeight, NULL, hi, identity, map, combine, pool);
+            });
+            T leftResult = reduceParallel(node->getLeft(), childHeight(node, height, 0), lo, NULL,
+                                          identity, map, combine, pool);
+            T middle = combine(leftResult, map(node->getItem()));
+            group.wait();
+            return combine(middle, rightResult);
+        }
+    }
+    T result = identity;
+    auto accumulate = [&](const std::pair<const Key, Value>& item) {
+        result = combine(result, map(item));
+    };
+    forEachSequential(node, lo, hi, accumulate);
+    return result;
+}
+
+/**
+* Calls fn(item) for every item in the tree, spreading the work over the
+* pool's threads. Items are visited in no particular order and fn may run
+* on several threads at once, so it must be safe to call concurrently.
+* The tree must not be modified until the call returns. If fn throws, the
+* first exception is rethrown once the outstanding tasks have finished.
+*/
+template<class Key, class Value>
+template<typename Fn>
+void AVLTree<Key, Value>::parallel_for_each(Fn fn, ThreadPool& pool) const
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    ThreadPool::TaskGroup group(pool);
+    forEachParallel(root, subtreeHeight(root), NULL, NULL, fn, group);
+    group.wait();
+}
+
+/**
+* As above, restricted to the items with lo <= key < hi.
+*/
+template<class Key, class Value>
+template<typename Fn>
+void AVLTree<Key, Value>::parallel_for_each(const Key& lo, const Key& hi, Fn fn, ThreadPool& pool) const
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    ThreadPool::TaskGroup group(pool);
+    forEachParallel(root, subtreeHeight(root), &lo, &hi, fn, group);
+    group.wait();
+}
+
+/**
+* Returns combine(...combine(combine(identity, map(item1)), map(item2))...)
+* over the items in key order, computed in parallel. combine must be
+* associative with identity as its identity element. It need not be
+* commutative, since partial results are always combined in key order.
+* map and combine may run on several threads at once.
+*/
+template<class Key, class Value>
+template<typename T, typename Map, typename Combine>
+T AVLTree<Key, Value>::parallel_reduce(T identity, Map map, Combine combine, ThreadPool& pool) const
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    return reduceParallel(root, subtreeHeight(root), NULL, NULL, identity, map, combine, pool);
+}
+
+/**
+* As above, restricted to the items with lo <= key < hi.
+*/
+template<class Key, class Value>
+template<typename T, typename Map, typename Combine>
+T AVLTree<Key, Value>::parallel_reduce(const Key& lo, const Key& hi, T identity, Map map, Combine combine,
+                                       ThreadPool& pool) const
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    return reduceParallel(root, subtreeHeight(root), &lo, &hi, identity, map, combine, pool);
+}
+
+/**
+* Makes left and right the children of node and sets its balance from the
+* given subtree heights. Returns node, with its height in height.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::linkNode(AVLNode<Key, Value>* node, AVLNode<Key, Value>* left, int leftHeight,
+                                                   AVLNode<Key, Value>* right, int rightHeight, int& height)
+{
+    node->setLeft(left);
+    node->setRight(right);
+    if (left != NULL) { left->setParent(node); }
+    if (right != NULL) { right->setParent(node); }
+    node->setBalance(static_cast<int8_t>(rightHeight - leftHeight));
+    height = std::max(leftHeight, rightHeight) + 1;
+    updateSubtree(node);
+    return node;
+}
+
+/**
+* linkNode with the sides named relative to dir: inner goes on the dir
+* side of node and outer on the other.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::linkSide(AVLNode<Key, Value>* node, AVLNode<Key, Value>* outer, int outerHeight,
+                                                   AVLNode<Key, Value>* inner, int innerHeight, int dir, int& height)
+{
+    if (dir == 1) {
+        return linkNode(node, outer, outerHeight, inner, innerHeight, height);
+    }
+    return linkNode(node, inner, innerHeight, outer, outerHeight, height);
+}
+
+/**
+* Joins two detached AVL subtrees and a middle node, where every key in
+* left is below mid's key and every key in right above it. Runs in
+* O(|leftHeight - rightHeight| + 1) and returns the root, with its height
+* in height. The root's parent link is left for the caller.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinTrees(AVLNode<Key, Value>* left, int leftHeight, AVLNode<Key, Value>* mid,
+                                                    AVLNode<Key, Value>* right, int rightHeight, int& height)
+{
+    if (leftHeight > rightHeight + 1) {
+        return joinTaller(left, leftHeight, mid, right, rightHeight, 1, height);
+    }
+    if (rightHeight > leftHeight + 1) {
+        return joinTaller(right, rightHeight, mid, left, leftHeight, 0, height);
+    }
+    return linkNode(mid, left, leftHeight, right, rightHeight, height);
+}
+
+/**
+* joinTrees when tall is more than one level taller than shorter: walks
+* down tall's dir-side spine to a subtree no more than one level taller
+* than shorter, hangs mid there with shorter on its dir side, and fixes
+* the balance with at most one single or double rotation on the way back up.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinTaller(AVLNode<Key, Value>* tall, int tallHeight, AVLNode<Key, Value>* mid,
+                                                     AVLNode<Key, Value>* shorter, int shorterHeight, int dir, int& height)
+{
+    AVLNode<Key, Value>* outer = static_cast<AVLNode<Key, Value>*>(tall->getChild(1 - dir));
+    AVLNode<Key, Value>* spine = static_cast<AVLNode<Key, Value>*>(tall->getChild(dir));
+    int outerHeight = childHeight(tall, tallHeight, 1 - dir);
+    int spineHeight = childHeight(tall, tallHeight, dir);
+
+    if (spineHeight <= shorterHeight + 1) {
+        AVLNode<Key, Value>* a = static_cast<AVLNode<Key, Value>*>(spine != NULL ? spine->getChild(1 - dir) : NULL);
+        AVLNode<Key, Value>* b = static_cast<AVLNode<Key, Value>*>(spine != NULL ? spine->getChild(dir) : NULL);
+        int aHeight = spine != NULL ? childHeight(spine, spineHeight, 1 - dir) : 0;
+        int bHeight = spine != NULL ? childHeight(spine, spineHeight, dir) : 0;
+
+        int midHeight;
+        linkSide(mid, spine, spineHeight, shorter, shorterHeight, dir, midHeight);
+        if (midHeight <= outerHeight + 1) {
+            return linkSide(tall, outer, outerHeight, mid, midHeight, dir, height);
+        }
+        // mid leans away from dir: a double rotation lifts spine above
+        // both tall and mid.
+        int tallNewHeight;
+        linkSide(tall, outer, outerHeight, a, aHeight, dir, tallNewHeight);
+        linkSide(mid, b, bHeight, shorter, shorterHeight, dir, midHeight);
+        return linkSide(spine, tall, tallNewHeight, mid, midHeight, dir, height);
+    }
+
+    int joinedHeight;
+    AVLNode<Key, Value>* joined = joinTaller(spine, spineHeight, mid, shorter, shorterHeight, dir, joinedHeight);
+    if (joinedHeight <= outerHeight + 1) {
+        return linkSide(tall, outer, outerHeight, joined, joinedHeight, dir, height);
+    }
+    // A single rotation lifts the joined subtree's root above tall.
+    AVLNode<Key, Value>* a = static_cast<AVLNode<Key, Value>*>(joined->getChild(1 - dir));
+    AVLNode<Key, Value>* b = static_cast<AVLNode<Key, Value>*>(joined->getChild(dir));
+    int aHeight = childHeight(joined, joinedHeight, 1 - dir);
+    int bHeight = childHeight(joined, joinedHeight, dir);
+    int tallNewHeight;
+    linkSide(tall, outer, outerHeight, a, aHeight, dir, tallNewHeight);
+    return linkSide(joined, tall, tallNewHeight, b, bHeight, dir, height);
+}
+
+/**
+* Splits the subtree into the nodes with keys below key (less) and the
+* rest, each a valid AVL tree. The joins along the search path telescope,
+* so the whole split is O(log n).
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::splitTree(AVLNode<Key, Value>* node, int height, const Key& key,
+                                    AVLNode<Key, Value>*& less, int& lessHeight,
+                                    AVLNode<Key, Value>*& rest, int& restHeight)
+{
+    if (node == NULL) {
+        less = rest = NULL;
+        lessHeight = restHeight = 0;
+        return;
+    }
+    AVLNode<Key, Value>* left = node->getLeft();
+    AVLNode<Key, Value>* right = node->getRight();
+    int leftHeight = childHeight(node, height, 0);
+    int rightHeight = childHeight(node, height, 1);
+    if (node->getKey() < key) {
+        AVLNode<Key, Value>* rightLess;
+        int rightLessHeight;
+        splitTree(right, rightHeight, key, rightLess, rightLessHeight, rest, restHeight);
+        less = joinTrees(left, leftHeight, node, rightLess, rightLessHeight, lessHeight);
+    }
+    else {
+        AVLNode<Key, Value>* leftRest;
+        int leftRestHeight;
+        splitTree(left, leftHeight, key, less, lessHeight, leftRest, leftRestHeight);
+        rest = joinTrees(leftRest, leftRestHeight, node, right, rightHeight, restHeight);
+    }
+}
+
+/**
+* Detaches the largest node of a non-empty subtree into last and returns
+* what remains, rebalanced, with its height in restHeight.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::splitLast(AVLNode<Key, Value>* node, int height,
+                                                    AVLNode<Key, Value>*& last, int& restHeight)
+{
+    AVLNode<Key, Value>* left = node->getLeft();
+    int leftHeight = childHeight(node, height, 0);
+    if (node->getRight() == NULL) {
+        last = node;
+        restHeight = leftHeight;
+        return left;
+    }
+    int rightRestHeight;
+    AVLNode<Key, Value>* rightRest = splitLast(node->getRight(), childHeight(node, height, 1), last, rightRestHeight);
+    return joinTrees(left, leftHeight, node, rightRest, rightRestHeight, restHeight);
+}
+
+/**
+* Frees a detached subtree through destroyNode and returns its size.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::destroySubtree(AVLNode<Key, Value>* node)
+{
+    if (node == NULL) {
+        return 0;
+    }
+    size_t count = destroySubtree(node->getLeft()) + destroySubtree(node->getRight()) + 1;
+    this->destroyNode(node);
+    return count;
+}
+
+/**
+* Installs a rebuilt tree and recomputes the cached smallest and largest
+* nodes.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::setRoot(AVLNode<Key, Value>* root)
+{
+    this->root_ = root;
+    this->leftmost_ = this->rightmost_ = root;
+    if (root == NULL) {
+        return;
+    }
+    root->setParent(NULL);
+    while (this->leftmost_->getLeft() != NULL) {
+        this->leftmost_ = this->leftmost_->getLeft();
+    }
+    while (this->rightmost_->getRight() != NULL) {
+        this->rightmost_ = this->rightmost_->getRight();
+    }
+}
+
+/**
+* Removes every item with lo <= key < hi and returns how many there were.
+* Instead of k separate removals the tree is split at lo and at hi, the
+* middle part is freed in one pass and the outer parts are joined again:
+* O(log n) restructuring plus the k frees. Iterators to the removed items
+* are invalidated; all others stay valid.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::erase(const Key& lo, const Key& hi)
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    if (root == NULL || !(lo < hi)) {
+        return 0;
+    }
+    AVLNode<Key, Value>* below;
+    AVLNode<Key, Value>* from;
+    AVLNode<Key, Value>* range;
+    AVLNode<Key, Value>* above;
+    int belowHeight, fromHeight, rangeHeight, aboveHeight;
+    splitTree(root, subtreeHeight(root), lo, below, belowHeight, from, fromHeight);
+    splitTree(from, fromHeight, hi, range, rangeHeight, above, aboveHeight);
+
+    size_t erased = destroySubtree(range);
+
+    if (below == NULL) {
+        setRoot(above);
+    }
+    else if (above == NULL) {
+        setRoot(below);
+    }
+    else {
+        AVLNode<Key, Value>* last;
+        int restHeight, height;
+        AVLNode<Key, Value>* rest = splitLast(below, belowHeight, last, restHeight);
+        setRoot(joinTrees(rest, restHeight, last, above, aboveHeight, height));
+    }
+    this->afterRemoval();
+    return erased;
+}
+
+/**
+* Joins two detached subtrees where every key in left is below every key
+* in right, using left's largest node as the pivot.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinPair(AVLNode<Key, Value>* left, int leftHeight,
+                                                   AVLNode<Key, Value>* right, int rightHeight, int& height)
+{
+    if (left == NULL) {
+        height = rightHeight;
+        return right;
+    }
+    if (right == NULL) {
+        height = leftHeight;
+        return left;
+    }
+    AVLNode<Key, Value>* last;
+    int restHeight;
+    AVLNode<Key, Value>* rest = splitLast(left, leftHeight, last, restHeight);
+    return joinTrees(rest, restHeight, last, right, rightHeight, height);
+}
+
+/**
+* Removes the keys in the sorted, duplicate-free range [first, last) from
+* the subtree and returns its new root, with the new height in newHeight.
+* The keys are partitioned around the node's key and each side recurses
+* only if it has keys to remove, so untouched subtrees are returned as
+* they are. The two halves are then joined back around the node, or
+* without it if it was one of the keys.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::removeSorted(AVLNode<Key, Value>* node, int height,
+                                                       const Key* first, const Key* last,
+                                                       int& newHeight, size_t& removed)
+{
+    if (node == NULL || first == last) {
+        newHeight = height;
+        return node;
+    }
+    const Key* split = std::lower_bound(first, last, node->getKey());
+    bool hit = split != last && !(node->getKey() < *split);
+
+    int leftHeight, rightHeight;
+    AVLNode<Key, Value>* left = removeSorted(node->getLeft(), childHeight(node, height, 0),
+                                             first, split, leftHeight, removed);
+    AVLNode<Key, Value>* right = removeSorted(node->getRight(), childHeight(node, height, 1),
+                                              hit ? split + 1 : split, last, rightHeight, removed);
+    if (hit) {
+        this->destroyNode(node);
+        ++removed;
+        return joinPair(left, leftHeight, right, rightHeight, newHeight);
+    }
+    return joinTrees(left, leftHeight, node, right, rightHeight, newHeight);
+}
+
+/**
+* Removes every key in keys that is present and returns how many were.
+* The keys are sorted (unless they already are) and removed in a single
+* top-down pass that visits only the subtrees containing some of them;
+* balance is restored by joins on the way back up, once per visited node.
+* For k keys this is O(k log(n/k + 1)) rather than the O(k log n) of k
+* separate removes. Iterators to the remaining items stay valid.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::remove_batch(const std::vector<Key>& keys)
+{
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    if (root == NULL || keys.empty()) {
+        return 0;
+    }
+    std::vector<Key> sorted;
+    const std::vector<Key>* ordered = &keys;
+    bool unique = true;
+    for (size_t i = 1; i < keys.size() && unique; ++i) {
+        unique = keys[i - 1] < keys[i];
+    }
+    if (!unique) {
+        sorted = keys;
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                                 [](const Key& a, const Key& b) { return !(a < b) && !(b < a); }),
+                     sorted.end());
+        ordered = &sorted;
+    }
+
+    size_t removed = 0;
+    int height;
+    const Key* first = &(*ordered)[0];
+    root = removeSorted(root, subtreeHeight(root), first, first + ordered->size(), height, removed);
+    setRoot(root);
+    this->afterRemoval();
+    return removed;
+}
+
+/**
+* Inserts the other tree's items in order, each search starting from
+* where the previous one ended: climb to the lowest ancestor whose key is
+* above the new key, then descend. Consecutive keys d positions apart cost
+* O(log d) rather than O(log n), so the whole merge is O(m log(n/m + 1)),
+* and new nodes are attached and rebalanced as by insert.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::mergeFinger(const AVLTree<Key, Value>& other, const Resolver& resolve, size_t& added)
+{
+    AVLNode<Key, Value>* finger = static_cast<AVLNode<Key, Value>*>(this->root_);
+    for (Node<Key, Value>* theirs = other.leftmost_; theirs != NULL; theirs = this->successor(theirs)) {
+        const Key& key = theirs->getKey();
+        AVLNode<Key, Value>* node = finger;
+        // Every node passed on the way up is at most key, so key belongs
+        // under the node the climb stops at.
+        while (node->getParent() != NULL && !(key < node->getParent()->getKey())) {
+            node = node->getParent();
+        }
+        AVLNode<Key, Value>* parent = NULL;
+        int dir = 0;
+        while (node != NULL) {
+            if (key < node->getKey()) {
+                dir = 0;
+            }
+            else if (node->getKey() < key) {
+                dir = 1;
+            }
+            else {
+                break;
+            }
+            parent = node;
+            node = static_cast<AVLNode<Key, Value>*>(node->getChild(dir));
+        }
+        if (node != NULL) {
+            assignValue(node, resolve(key, node->getValue(), theirs->getValue()));
+            updatePath(node);
+            finger = node;
+        }
+        else {
+            finger = attachNode(parent, dir == 1, theirs->getItem());
+            ++added;
+        }
+    }
+}
+
+/**
+* Links the sorted nodes into a perfectly balanced tree and returns its
+* root, with its height in height.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::buildBalanced(AVLNode<Key, Value>* const* nodes, size_t count, int& height)
+{
+    if (count == 0) {
+        height = 0;
+        return NULL;
+    }
+    size_t mid = count / 2;
+    int leftHeight, rightHeight;
+    AVLNode<Key, Value>* left = buildBalanced(nodes, mid, leftHeight);
+    AVLNode<Key, Value>* right = buildBalanced(nodes + mid + 1, count - mid - 1, rightHeight);
+    return linkNode(nodes[mid], left, leftHeight, right, rightHeight, height);
+}
+
+/**
+* Merges the two in-order sequences into one list of nodes, this tree's
+* own plus new ones for the other's keys, and rebuilds the tree from it.
+* O(n + m) with no rebalancing.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::mergeLinear(const AVLTree<Key, Value>& other, const Resolver& resolve, size_t& added)
+{
+    std::vector<AVLNode<Key, Value>*> merged;
+    Node<Key, Value>* mine = this->leftmost_;
+    Node<Key, Value>* theirs = other.leftmost_;
+    while (mine != NULL || theirs != NULL) {
+        if (theirs == NULL || (mine != NULL && mine->getKey() < theirs->getKey())) {
+            merged.push_back(static_cast<AVLNode<Key, Value>*>(mine));
+            mine = this->successor(mine);
+        }
+        else if (mine == NULL || theirs->getKey() < mine->getKey()) {
+            merged.push_back(static_cast<AVLNode<Key, Value>*>(
+                this->createNode(theirs->getKey(), theirs->getValue(), NULL)));
+            ++added;
+            theirs = this->successor(theirs);
+        }
+        else {
+            assignValue(static_cast<AVLNode<Key, Value>*>(mine),
+                        resolve(mine->getKey(), mine->getValue(), theirs->getValue()));
+            merged.push_back(static_cast<AVLNode<Key, Value>*>(mine));
+            mine = this->successor(mine);
+            theirs = this->successor(theirs);
+        }
+    }
+    int height;
+    setRoot(buildBalanced(merged.data(), merged.size(), height));
+}
+
+/**
+* Adds every item of other to this tree and returns how many keys were
+* new. For a key in both trees, resolve(key, mine, theirs) gives the value
+* to keep. other is left unchanged. The work is done by mergeWith, which
+* derived trees override.
+*/
+template<class Key, class Value>
+template <typename Resolve>
+size_t AVLTree<Key, Value>::merge(const AVLTree<Key, Value>& other, Resolve resolve)
+{
+    return mergeWith(other, Resolver(resolve));
+}
+
+/**
+* merge where other's value wins for keys in both trees, as with insert.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::merge(const AVLTree<Key, Value>& other)
+{
+    return mergeWith(other, [](const Key&, const Value&, const Value& theirs) { return theirs; });
+}
+
+/**
+* A much smaller other (MERGE_FINGER_HEIGHT_GAP or more levels shorter)
+* is merged in by finger insertions, O(m log(n/m + 1)). Otherwise the two
+* in-order sequences are merged and the tree rebuilt, O(n + m). The sizes
+* are judged from the heights, which take O(log n) to read. Either way
+* iterators to this tree's items stay valid.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::mergeWith(const AVLTree<Key, Value>& other, const Resolver& resolve)
+{
+    if (this == &other) {
+        AVLTree<Key, Value> snapshot(other);
+        return mergeWith(snapshot, resolve);
+    }
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    AVLNode<Key, Value>* theirs = static_cast<AVLNode<Key, Value>*>(other.root_);
+    if (theirs == NULL) {
+        return 0;
+    }
+    size_t added = 0;
+    int height = subtreeHeight(root);
+    int theirHeight = subtreeHeight(theirs);
+    if (theirHeight + MERGE_FINGER_HEIGHT_GAP <= height) {
+        mergeFinger(other, resolve, added);
+    }
+    else {
+        mergeLinear(other, resolve, added);
+    }
+    return added;
+}
 
 #endif
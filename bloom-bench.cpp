@@ -0,0 +1,95 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include "avlbst.h"
+#include "bloomavl.h"
+
+using namespace std;
+
+/*
+ * Measures the cost of a find that misses: a plain AVLTree against
+ * BloomAVLTrees whose filters range from 2 to 16 bits per key. Keys and
+ * probes are drawn from disjoint halves of the 64-bit range (odd vs even),
+ * so every probe misses and the hit rate printed is the filter's false
+ * positive rate.
+ */
+
+static const size_t KEYS = 1 << 20;
+static const size_t PROBES = 1 << 22;
+
+// Lookup results are summed into a global so the compiler cannot move
+// the timed loop past the clock reads.
+size_t found = 0;
+
+template <typename Tree>
+void fill(Tree& tree, const vector<uint64_t>& keys)
+{
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], 0));
+    }
+}
+
+/**
+ * Times a find for every probe and returns nanoseconds per find. The
+ * number of probes found (zero when the tree is correct) goes in found.
+ */
+template <typename Tree>
+double missLatency(const Tree& tree, const vector<uint64_t>& probes)
+{
+    found = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        found += tree.find(probes[i]) != tree.end();
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count() / probes.size();
+}
+
+int main(int argc, char *argv[])
+{
+    mt19937_64 rng(42);
+    vector<uint64_t> keys(KEYS), probes(PROBES);
+    for (size_t i = 0; i < KEYS; ++i) {
+        keys[i] = rng() | 1;
+    }
+    for (size_t i = 0; i < PROBES; ++i) {
+        probes[i] = rng() & ~1ull;
+    }
+
+    cout << KEYS << " keys, " << PROBES << " missing probes" << endl;
+    cout << setw(14) << "filter" << setw(12) << "ns/find" << setw(14) << "false pos" << endl;
+    cout << fixed;
+
+    {
+        AVLTree<uint64_t, int> plain;
+        fill(plain, keys);
+        double ns = missLatency(plain, probes);
+        cout << setw(14) << "none" << setw(12) << setprecision(1) << ns
+             << setw(14) << "-" << endl;
+    }
+
+    for (size_t bitsPerKey = 2; bitsPerKey <= 16; bitsPerKey *= 2) {
+        BloomAVLTree<uint64_t, int> tree(KEYS * bitsPerKey);
+        fill(tree, keys);
+        double ns = missLatency(tree, probes);
+        if (found != 0) {
+            break;
+        }
+        // The tree does not expose its filter, so rebuild an identical
+        // one to count the probes that got past it.
+        size_t passed = 0;
+        BloomFilter<uint64_t> filter(tree.filterBits());
+        for (size_t i = 0; i < KEYS; ++i) {
+            filter.add(keys[i]);
+        }
+        for (size_t i = 0; i < PROBES; ++i) {
+            passed += filter.mayContain(probes[i]);
+        }
+        cout << setw(10) << bitsPerKey << " b/k" << setw(12) << setprecision(1) << ns
+             << setw(13) << setprecision(3) << 100.0 * passed / PROBES << "%" << endl;
+    }
+    return found == 0 ? 0 : 1;
+}
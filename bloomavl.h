@@ -0,0 +1,177 @@
+#ifndef BLOOMAVL_H
+#define BLOOMAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include "avlbst.h"
+#include "bloomfilter.h"
+
+/**
+* An AVLTree with a blocked Bloom filter in front of its lookups. Every key
+* that enters the tree is added to the filter, and find (also operator[] and
+* remove) returns without descending when the filter rules the key out. That
+* pays off when most lookups miss.
+*
+* The filter does not forget removed keys. A stale key only costs an extra
+* false positive, so removals are just counted. Once the stale keys outnumber
+* the live ones, the filter is rebuilt from the tree, which keeps the rebuild
+* cost amortized O(1) per removal.
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class BloomAVLTree : public AVLTree<Key, Value>
+{
+public:
+    explicit BloomAVLTree(size_t filterBits = 1 << 16);
+    BloomAVLTree(const BloomAVLTree& other);
+    BloomAVLTree(BloomAVLTree&& other);
+    BloomAVLTree& operator=(const BloomAVLTree& other);
+    BloomAVLTree& operator=(BloomAVLTree&& other);
+
+    void rebuildFilter(size_t filterBits);
+    size_t filterBits() const;
+
+protected:
+    virtual Node<Key, Value>* internalFind(const Key& key) const;
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void destroyNode(Node<Key, Value>* node);
+    virtual void afterRemoval();
+
+    BloomFilter<Key, Hash> filter_;
+    size_t live_;   // keys in the tree
+    size_t stale_;  // removed keys still set in the filter
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the BloomAVLTree class.
+  ---------------------------------------------
+*/
+
+template<class Key, class Value, class Hash>
+BloomAVLTree<Key, Value, Hash>::BloomAVLTree(size_t filterBits) :
+    filter_(filterBits), live_(0), stale_(0)
+{
+
+}
+
+/**
+* The copy gets a fresh filter of the same size, filled by createNode as
+* the nodes are cloned, so it starts without other's stale keys.
+*/
+template<class Key, class Value, class Hash>
+BloomAVLTree<Key, Value, Hash>::BloomAVLTree(const BloomAVLTree& other) :
+    AVLTree<Key, Value>(), filter_(other.filterBits()), live_(0), stale_(0)
+{
+    this->cloneFrom(other);
+}
+
+/**
+* other is left with a zero-size filter, which passes every key, until
+* rebuildFilter gives it a new one.
+*/
+template<class Key, class Value, class Hash>
+BloomAVLTree<Key, Value, Hash>::BloomAVLTree(BloomAVLTree&& other) :
+    AVLTree<Key, Value>(std::move(other)), filter_(std::move(other.filter_)),
+    live_(other.live_), stale_(other.stale_)
+{
+    other.live_ = other.stale_ = 0;
+}
+
+/**
+* Takes other's filter size and rebuilds, dropping the keys of the nodes
+* that were replaced.
+*/
+template<class Key, class Value, class Hash>
+BloomAVLTree<Key, Value, Hash>& BloomAVLTree<Key, Value, Hash>::operator=(const BloomAVLTree& other)
+{
+    if (this != &other) {
+        AVLTree<Key, Value>::operator=(other);
+        rebuildFilter(other.filterBits());
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Hash>
+BloomAVLTree<Key, Value, Hash>& BloomAVLTree<Key, Value, Hash>::operator=(BloomAVLTree&& other)
+{
+    if (this != &other) {
+        AVLTree<Key, Value>::operator=(std::move(other));
+        std::swap(filter_, other.filter_);
+        other.filter_.clear();
+        live_ = other.live_;
+        stale_ = other.stale_;
+        other.live_ = other.stale_ = 0;
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Hash>
+size_t BloomAVLTree<Key, Value, Hash>::filterBits() const
+{
+    return filter_.bits();
+}
+
+/**
+* Resizes the filter and refills it from the keys currently in the tree.
+*/
+template<class Key, class Value, class Hash>
+void BloomAVLTree<Key, Value, Hash>::rebuildFilter(size_t filterBits)
+{
+    filter_.reset(filterBits);
+    for (Node<Key, Value>* n = this->leftmost_; n != NULL; n = this->successor(n)) {
+        filter_.add(n->getKey());
+    }
+    stale_ = 0;
+}
+
+/**
+* Consults the filter before descending the tree.
+*/
+template<class Key, class Value, class Hash>
+Node<Key, Value>* BloomAVLTree<Key, Value, Hash>::internalFind(const Key& key) const
+{
+    if (!filter_.mayContain(key)) {
+        return NULL;
+    }
+    return AVLTree<Key, Value>::internalFind(key);
+}
+
+template<class Key, class Value, class Hash>
+Node<Key, Value>* BloomAVLTree<Key, Value, Hash>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    filter_.add(key);
+    ++live_;
+    return AVLTree<Key, Value>::createNode(key, value, parent);
+}
+
+template<class Key, class Value, class Hash>
+void BloomAVLTree<Key, Value, Hash>::destroyNode(Node<Key, Value>* node)
+{
+    --live_;
+    ++stale_;
+    AVLTree<Key, Value>::destroyNode(node);
+}
+
+/**
+* Rebuilds the filter at its current size once the removed keys outnumber
+* the live ones. The tree runs this after every removal, single or bulk,
+* once it has finished rebalancing, so the rebuild walks a consistent tree.
+*/
+template<class Key, class Value, class Hash>
+void BloomAVLTree<Key, Value, Hash>::afterRemoval()
+{
+    if (stale_ > live_ && stale_ >= 64) {
+        rebuildFilter(filter_.bits());
+    }
+}
+
+/*
+  -------------------------------------------
+  End implementations for the BloomAVLTree class.
+  -------------------------------------------
+*/
+
+#endif
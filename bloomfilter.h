@@ -0,0 +1,162 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+* A blocked Bloom filter. Each key maps to one 512-bit block (a single cache
+* line) and sets one bit in each of the block's eight 64-bit words, so a
+* membership test costs one hash and one cache miss regardless of the filter
+* size. There are no false negatives; the false positive rate falls as the
+* number of bits per key grows (roughly 2% at 8 bits per key, 0.1% at 16).
+*
+* Keys cannot be removed from the filter itself. Owners that delete keys
+* rebuild it from their live keys once enough removals have accumulated.
+*/
+template <typename Key, typename Hash = std::hash<Key> >
+class BloomFilter
+{
+public:
+    static const size_t WORDS_PER_BLOCK = 8;
+    static const size_t BLOCK_BITS = 64 * WORDS_PER_BLOCK;
+
+    explicit BloomFilter(size_t bits = 0);
+
+    void add(const Key& key);
+    bool mayContain(const Key& key) const;
+    void reset(size_t bits);
+    void clear();
+    size_t bits() const;
+
+protected:
+    uint64_t hashOf(const Key& key) const;
+    size_t block(uint64_t hash) const;
+    static uint64_t mask(uint64_t hash, size_t word);
+
+    std::vector<uint64_t> words_;
+    unsigned shift_;    // 64 - log2(number of blocks)
+    Hash hash_;
+};
+
+/*
+  --------------------------------------------
+  Begin implementations for the BloomFilter class.
+  --------------------------------------------
+*/
+
+template<class Key, class Hash>
+BloomFilter<Key, Hash>::BloomFilter(size_t bits) :
+    shift_(64)
+{
+    reset(bits);
+}
+
+template<class Key, class Hash>
+size_t BloomFilter<Key, Hash>::bits() const
+{
+    return words_.size() * 64;
+}
+
+/**
+* Empties the filter and resizes it to at least the given number of bits,
+* rounded up to a power-of-two number of blocks. Zero bits gives a filter
+* with no blocks, which answers "maybe" for every key.
+*/
+template<class Key, class Hash>
+void BloomFilter<Key, Hash>::reset(size_t bits)
+{
+    size_t blocks = 0;
+    shift_ = 64;
+    if (bits > 0) {
+        blocks = 1;
+        while (blocks * BLOCK_BITS < bits) {
+            blocks <<= 1;
+            --shift_;
+        }
+    }
+    words_.assign(blocks * WORDS_PER_BLOCK, 0);
+}
+
+/**
+* Clears every bit but keeps the size.
+*/
+template<class Key, class Hash>
+void BloomFilter<Key, Hash>::clear()
+{
+    words_.assign(words_.size(), 0);
+}
+
+/**
+* Mixes the user hash (std::hash of an integer is the integer itself).
+* The top bits select the block and the bottom 32 bits the bit in each word.
+*/
+template<class Key, class Hash>
+uint64_t BloomFilter<Key, Hash>::hashOf(const Key& key) const
+{
+    uint64_t h = static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+    return h ^ ((h >> 29) * 0xBF58476D1CE4E5B9ull >> 32);
+}
+
+template<class Key, class Hash>
+size_t BloomFilter<Key, Hash>::block(uint64_t hash) const
+{
+    return shift_ == 64 ? 0 : static_cast<size_t>(hash >> shift_);
+}
+
+/**
+* Picks the bit a hash sets in the given word of its block. Each word
+* multiplies the low half of the hash by its own odd salt and keeps the
+* top six bits of the product.
+*/
+template<class Key, class Hash>
+uint64_t BloomFilter<Key, Hash>::mask(uint64_t hash, size_t word)
+{
+    static const uint32_t SALT[WORDS_PER_BLOCK] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+    uint32_t x = static_cast<uint32_t>(hash) * SALT[word];
+    return 1ull << (x >> 26);
+}
+
+template<class Key, class Hash>
+void BloomFilter<Key, Hash>::add(const Key& key)
+{
+    if (words_.empty()) {
+        return;
+    }
+    uint64_t h = hashOf(key);
+    uint64_t* w = &words_[block(h) * WORDS_PER_BLOCK];
+    for (size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        w[i] |= mask(h, i);
+    }
+}
+
+/**
+* Returns false only if the key was never added since the last reset.
+*/
+template<class Key, class Hash>
+bool BloomFilter<Key, Hash>::mayContain(const Key& key) const
+{
+    if (words_.empty()) {
+        return true;
+    }
+    uint64_t h = hashOf(key);
+    const uint64_t* w = &words_[block(h) * WORDS_PER_BLOCK];
+    uint64_t missing = 0;
+    for (size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        missing |= mask(h, i) & ~w[i];
+    }
+    return missing == 0;
+}
+
+/*
+  ------------------------------------------
+  End implementations for the BloomFilter class.
+  ------------------------------------------
+*/
+
+#endif
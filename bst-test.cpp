@@ -1,7 +1,24 @@
 #include <iostream>
 #include <map>
+#include <vector>
+#include <string>
 #include "bst.h"
 #include "avlbst.h"
+#include "pooledavl.h"
+#include "stackavl.h"
+#include "threadavl.h"
+#include "slabavl.h"
+#include "smallavl.h"
+#include "hashavl.h"
+#include "bloomavl.h"
+#include "art.h"
+#include "multiavl.h"
+#include "cacheavl.h"
+#include "merkleavl.h"
+#include "sharedavl.h"
+#include "weightedbst.h"
+#include <unistd.h>
+#include <sys/wait.h>
 
 using namespace std;
 
@@ -25,11 +42,17 @@ int main(int argc, char *argv[])
     }
     cout << "Erasing b" << endl;
     bt.remove('b');
+    bt['c'] = 3; // inserts c
+    if(!bt.find_or_insert(std::make_pair('c',4)).second) {
+        cout << "c already present with " << bt['c'] << endl;
+    }
+    cout << "Erasing a, next is " << bt.erase(bt.find('a'))->first << endl;
 
     // AVL Tree Tests
     AVLTree<char,int> at;
     at.insert(std::make_pair('a',1));
     at.insert(std::make_pair('b',2));
+    at.insert(at.end(), std::make_pair('c',3)); // hinted append
 
     cout << "\nAVLTree contents:" << endl;
     for(AVLTree<char,int>::iterator it = at.begin(); it != at.end(); ++it) {
@@ -43,6 +66,278 @@ int main(int argc, char *argv[])
     }
     cout << "Erasing b" << endl;
     at.remove('b');
+    cout << "Min is " << at.min()->first << ", max is " << at.max()->first << endl;
+    std::pair<char,int> smallest = at.extract_min();
+    cout << "Extracted " << smallest.first << " " << smallest.second << endl;
+
+    AVLTree<int,int> big;
+    for(int i = 1; i <= 10000; ++i) {
+        big.insert(big.end(), std::make_pair(i, i % 10));
+    }
+    long total = big.parallel_reduce(0L,
+        [](const std::pair<const int,int>& item) { return (long)item.second; },
+        [](long a, long b) { return a + b; });
+    cout << "Parallel sum of values: " << total << endl;
+    long inRange = big.parallel_reduce(100, 200, 0L,
+        [](const std::pair<const int,int>&) { return 1L; },
+        [](long a, long b) { return a + b; });
+    cout << "Keys in [100, 200): " << inRange << endl;
+    big.compact(); // relocate into one block in van Emde Boas order
+    big.remove(5000);
+    big.insert(std::make_pair(5000, 42)); // reuses the freed slot
+    cout << "After compact, 5000 maps to " << big[5000] << endl;
+    size_t expired = big.erase(2000, 8000); // keys in [2000, 8000)
+    cout << "Range erase removed " << expired << ", min is " << big.min()->first
+         << ", max is " << big.max()->first << endl;
+    std::vector<int> stale;
+    for(int i = 1; i <= 10000; i += 7) {
+        stale.push_back(i);
+    }
+    cout << "Batch removal removed " << big.remove_batch(stale) << endl;
+    AVLTree<int,int> snapshot(big);
+    big.clear();
+    AVLTree<int,int> moved(std::move(snapshot));
+    cout << "Copy kept " << moved.parallel_reduce(0, [](const std::pair<const int,int>&) { return 1; },
+                                                  [](int a, int b) { return a + b; })
+         << " items after the original was cleared" << endl;
+    AVLTree<int,int> delta;
+    delta.insert(std::make_pair(9000, 100));
+    delta.insert(std::make_pair(20000, 1));
+    size_t added = moved.merge(delta, [](const int&, const int& mine, const int& theirs) { return mine + theirs; });
+    cout << "Merge added " << added << " keys, 9000 now maps to " << moved[9000] << endl;
+
+    // Pooled AVL Tree tests
+    PooledAVLTree<char,int> pt;
+    pt.insert(std::make_pair('a',1));
+    pt.insert(std::make_pair('b',2));
+
+    cout << "\nPooledAVLTree contents:" << endl;
+    for(PooledAVLTree<char,int>::iterator it = pt.begin(); it != pt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    PooledAVLTree<char,int> ptCopy(pt);
+    cout << "Erasing b" << endl;
+    pt.remove('b');
+    cout << "Copy still has " << ptCopy.size() << " entries" << endl;
+
+    // Parent-free AVL Tree tests
+    StackAVLTree<char,int> st;
+    st.insert(std::make_pair('a',1));
+    st.insert(std::make_pair('b',2));
+
+    cout << "\nStackAVLTree contents:" << endl;
+    for(StackAVLTree<char,int>::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(st.find('b') != st.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    st.remove('b');
+
+    // Threaded AVL Tree tests
+    ThreadedAVLTree<char,int> tt;
+    tt.insert(std::make_pair('a',1));
+    tt.insert(std::make_pair('b',2));
+    tt.insert(std::make_pair('c',3));
+
+    cout << "\nThreadedAVLTree contents, backwards:" << endl;
+    for(ThreadedAVLTree<char,int>::iterator it = tt.max(); it != tt.end(); --it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing b" << endl;
+    tt.remove('b');
+
+    // Out-of-line value AVL Tree tests
+    SlabAVLTree<char,int> lt;
+    lt.insert(std::make_pair('a',1));
+    lt.insert(std::make_pair('b',2));
+    lt.find('a')->second = 10;
+
+    cout << "\nSlabAVLTree contents:" << endl;
+    for(SlabAVLTree<char,int>::iterator it = lt.begin(); it != lt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing b" << endl;
+    lt.remove('b');
+
+    // Small inline map tests
+    SmallAVLMap<char,int,2> sm;
+    sm.insert(std::make_pair('b',2));
+    sm.insert(std::make_pair('a',1));
+    cout << "\nSmallAVLMap is " << (sm.isInline() ? "inline" : "a tree") << endl;
+    sm.insert(std::make_pair('c',3));
+    cout << "After a third insert it is " << (sm.isInline() ? "inline" : "a tree") << ":" << endl;
+    for(SmallAVLMap<char,int,2>::iterator it = sm.begin(); it != sm.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Hash-indexed AVL Tree tests
+    HashedAVLTree<std::string,int> ht;
+    ht.insert(std::make_pair("apple",1));
+    ht.insert(std::make_pair("banana",2));
+    ht["cherry"] = 3;
+
+    cout << "\nHashedAVLTree contents:" << endl;
+    for(HashedAVLTree<std::string,int>::iterator it = ht.begin(); it != ht.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing banana" << endl;
+    ht.remove("banana");
+    cout << "banana is " << (ht.find("banana") == ht.end() ? "gone" : "still there") << endl;
+    ht.compact(); // the index follows the nodes into the block
+    cout << "After compact, cherry maps to " << ht.find("cherry")->second << endl;
+
+    // Bloom-filtered AVL Tree tests
+    BloomAVLTree<int,int> bft(4096);
+    for(int i = 0; i < 100; i += 2) {
+        bft.insert(std::make_pair(i, i * i));
+    }
+    cout << "\nBloomAVLTree with " << bft.filterBits() << " filter bits" << endl;
+    cout << "7 is " << (bft.find(7) == bft.end() ? "absent" : "present") << endl;
+    cout << "8 maps to " << bft[8] << endl;
+    bft.remove(8);
+    cout << "8 is " << (bft.find(8) == bft.end() ? "absent" : "present") << " after removal" << endl;
+
+    // Adaptive Radix Tree tests
+    AdaptiveRadixTree<int> art;
+    art.insert(std::make_pair("/usr/lib", 1));
+    art.insert(std::make_pair("/usr/local/bin", 2));
+    art.insert(std::make_pair("/usr/local/lib", 3));
+    art.insert(std::make_pair("/usr", 4));
+    art["/etc"] = 5;
+
+    cout << "\nAdaptiveRadixTree contents:" << endl;
+    for(AdaptiveRadixTree<int>::iterator it = art.begin(); it != art.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing /usr/local/bin" << endl;
+    art.remove("/usr/local/bin");
+    cout << "/usr/local/lib maps to " << art["/usr/local/lib"] << endl;
+
+    // AVL Multi Tree tests
+    AVLMultiTree<char,int> mt;
+    mt.insert(std::make_pair('b',1));
+    mt.insert(std::make_pair('a',2));
+    mt.insert(std::make_pair('b',3));
+    mt.insert(std::make_pair('b',4));
+    mt.insert(mt.find('b'), std::make_pair('b',5)); // still goes after the other b's
+
+    cout << "\nAVLMultiTree has " << mt.count('b') << " items with key b:" << endl;
+    std::pair<AVLMultiTree<char,int>::iterator, AVLMultiTree<char,int>::iterator> bs = mt.equal_range('b');
+    for(AVLMultiTree<char,int>::iterator it = bs.first; it != bs.second; ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    mt.erase(mt.find('b'));
+    cout << "After erasing one, b first maps to " << mt['b'] << endl;
+
+    // Capacity-bounded cache tests
+    CacheAVLTree<char,int> ct(3);
+    ct.insert(std::make_pair('a',1));
+    ct.insert(std::make_pair('b',2));
+    ct.insert(std::make_pair('c',3));
+    ct.find('a');
+    ct.insert(std::make_pair('d',4));
+    ct.compact(); // keeps the recency order
+
+    cout << "\nCacheAVLTree holds " << ct.size() << " of " << ct.capacity() << " items after evicting b:" << endl;
+    for(CacheAVLTree<char,int>::iterator it = ct.begin(); it != ct.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Merkle-hashed AVL Tree tests
+    MerkleAVLTree<char,int> primary, replica;
+    for(char c = 'a'; c <= 'h'; ++c) {
+        primary.insert(std::make_pair(c, c - 'a'));
+        replica.insert(std::make_pair('h' - (c - 'a'), 'h' - c));
+    }
+    cout << "\nMerkle replicas " << (primary.rootHash() == replica.rootHash() ? "match" : "differ") << endl;
+    primary.insert(std::make_pair('c', 30));
+    primary.remove('f');
+    cout << "After two edits they differ in:" << endl;
+    primary.diff(replica, [](const char& key, const int* mine, const int* theirs) {
+        cout << key << " " << (mine ? std::to_string(*mine) : "-") << " vs " << (theirs ? std::to_string(*theirs) : "-") << endl;
+    });
+    cout << "Sync applied " << replica.sync(primary) << " changes, replicas "
+         << (primary.rootHash() == replica.rootHash() ? "match" : "differ") << endl;
+    replica.compact(); // the nodes keep their hashes
+    cout << "After compacting one, replicas " << (primary.rootHash() == replica.rootHash() ? "match" : "differ") << endl;
+
+    // Shared-memory AVL Tree tests
+    std::string segment = "/bst-test-" + std::to_string(getpid());
+    SharedAVLTree<int,double> writer(segment.c_str(), 16);
+    for(int i = 1; i <= 5; ++i) {
+        writer.insert(std::make_pair(i * 10, i / 4.0));
+    }
+    writer.remove(30);
+    SharedAVLTree<int,double> reader(segment.c_str());
+    SharedAVLTree<int,double>::unlink(segment.c_str());
+    cout << "\nSharedAVLTree reader sees " << reader.size() << " of " << reader.capacity() << " slots:" << endl;
+    for(SharedAVLTree<int,double>::iterator it = reader.begin(); it != reader.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // A reader in another process walks and searches while the writer keeps
+    // inserting and removing; every value stays twice its key, so a torn
+    // read that got past the sequence checks would show.
+    std::string busySegment = segment + "-busy";
+    SharedAVLTree<int,int> busy(busySegment.c_str(), 4096);
+    for(int k = 0; k < 4000; k += 2) {
+        busy.insert(std::make_pair(k, 2 * k));
+    }
+    pid_t child = fork();
+    if(child == 0) {
+        SharedAVLTree<int,int> view(busySegment.c_str());
+        for(int round = 0; round < 200; ++round) {
+            int prev = -1;
+            for(SharedAVLTree<int,int>::iterator it = view.begin(); it != view.end(); ++it) {
+                if(it->first <= prev || it->second != 2 * it->first) {
+                    _exit(1);
+                }
+                prev = it->first;
+            }
+            for(int k = round % 7; k < 4000; k += 7) {
+                SharedAVLTree<int,int>::iterator it = view.find(k);
+                if(it != view.end() && it->second != 2 * k) {
+                    _exit(1);
+                }
+            }
+        }
+        _exit(0);
+    }
+    int status = 0;
+    unsigned step = 1;
+    while(waitpid(child, &status, WNOHANG) == 0) {
+        step = step * 1103515245u + 12345u;
+        int k = (step >> 8) % 4000;
+        if(step & 0x10000) {
+            busy.insert(std::make_pair(k, 2 * k));
+        }
+        else {
+            busy.remove(k);
+        }
+    }
+    SharedAVLTree<int,int>::unlink(busySegment.c_str());
+    cout << "Forked reader during writes: "
+         << (WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "consistent" : "INCONSISTENT") << endl;
+
+    // Access-weighted BST tests
+    WeightedBST<int,int> wt;
+    for(int i = 1; i <= 15; ++i) {
+        wt.insert(std::make_pair(i, i * i));
+    }
+    for(int round = 0; round < 20; ++round) {
+        wt.find(13);
+        if(round % 4 == 0) {
+            wt.find(2);
+        }
+    }
+    cout << "\nWeightedBST average depth " << wt.averageDepth() << " before reoptimize, ";
+    wt.reoptimize();
+    cout << wt.averageDepth() << " after; 13 was found " << wt.hits(wt.find(13)) << " times" << endl;
 
     return 0;
 }
@@ -5,6 +5,8 @@
 #include <exception>
 #include <cstdlib>
 #include <utility>
+#include <type_traits>
+#include <algorithm>
 
 /**
  * A templated class for a Node in a search tree.
@@ -29,6 +31,7 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    Node<Key, Value>* getChild(int dir) const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
@@ -38,8 +41,7 @@ public:
 protected:
     std::pair<const Key, Value> item_;
     Node<Key, Value>* parent_;
-    Node<Key, Value>* left_;
-    Node<Key, Value>* right_;
+    Node<Key, Value>* child_[2]; // [0] is the left child, [1] the right
 };
 
 /*
@@ -54,11 +56,10 @@ protected:
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
     item_(key, value),
-    parent_(parent),
-    left_(NULL),
-    right_(NULL)
+    parent_(parent)
 {
-
+    child_[0] = NULL;
+    child_[1] = NULL;
 }
 
 /**
@@ -132,7 +133,7 @@ Node<Key, Value>* Node<Key, Value>::getParent() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getLeft() const
 {
-    return left_;
+    return child_[0];
 }
 
 /**
@@ -141,7 +142,17 @@ Node<Key, Value>* Node<Key, Value>::getLeft() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getRight() const
 {
-    return right_;
+    return child_[1];
+}
+
+/**
+* A non-virtual getter for the left (dir 0) or right (dir 1) child. Search
+* loops use it to pick a child by index instead of branching on the side.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getChild(int dir) const
+{
+    return child_[dir];
 }
 
 /**
@@ -159,7 +170,7 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 template<typename Key, typename Value>
 void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 {
-    left_ = left;
+    child_[0] = left;
 }
 
 /**
@@ -168,7 +179,7 @@ void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 template<typename Key, typename Value>
 void Node<Key, Value>::setRight(Node<Key, Value>* right)
 {
-    right_ = right;
+    child_[1] = right;
 }
 
 /**
@@ -193,12 +204,21 @@ template <typename Key, typename Value>
 class BinarySearchTree
 {
 public:
+    class iterator;
+
     BinarySearchTree(); //TODO
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree(BinarySearchTree&& other);
     virtual ~BinarySearchTree(); //TODO
-    virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other);
+    virtual std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
+    iterator erase(iterator pos);
+    std::pair<iterator, bool> find_or_insert(const std::pair<const Key, Value>& keyValuePair);
     void clear(); //TODO
     bool isBalanced() const; //TODO
+    virtual int height() const;
     void print() const;
     bool empty() const;
 
@@ -230,15 +250,25 @@ public:
 public:
     iterator begin() const;
     iterator end() const;
+    iterator min() const;
+    iterator max() const;
     iterator find(const Key& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
+    std::pair<Key, Value> extract_min();
+    std::pair<Key, Value> extract_max();
 
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    virtual Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    Node<Key, Value>* descend(const Key& key, int& dir) const;
+    Node<Key, Value>* descend(const Key& key, int& dir, std::true_type) const;
+    Node<Key, Value>* descend(const Key& key, int& dir, std::false_type) const;
     Node<Key, Value> *getSmallestNode() const;  // TODO
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
+    static Node<Key, Value>* successor(Node<Key, Value>* current);
+    static iterator makeIterator(Node<Key, Value>* node);
+    static Node<Key, Value>* iteratorNode(const iterator& it);
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
 
@@ -247,12 +277,21 @@ protected:
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
 
     // Add helper functions here
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void destroyNode(Node<Key, Value>* node);
+    virtual std::pair<Node<Key, Value>*, bool> internalInsert(
+        const std::pair<const Key, Value>& keyValuePair, bool overwrite);
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual void afterRemoval();
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+    void cloneFrom(const BinarySearchTree<Key, Value>& other);
     void clearHelper(Node<Key, Value>* node); 
     int balanceHelper(Node<Key, Value>* node) const; 
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    Node<Key, Value>* leftmost_;  // smallest node, so begin() is O(1)
+    Node<Key, Value>* rightmost_; // largest node, so appends skip the descent
 };
 
 /*
@@ -336,24 +375,7 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator&
 BinarySearchTree<Key, Value>::iterator::operator++()
 {
-    if (current_->getRight() != nullptr) { // has a child
-        current_ = current_->getRight();
-        while (current_->getLeft() != nullptr) {
-            current_ = current_->getLeft();
-        }
-    }
-    else { // does not have a child
-        Node<Key, Value>* child = current_;
-        Node<Key, Value>* parent = current_->getParent();
-
-        while (parent != nullptr && parent->getRight() == child) {
-            child = parent;
-            parent = parent->getParent();
-        }
-
-        current_ = parent;
-    }
-
+    current_ = successor(current_);
     return *this;
 }
 
@@ -377,7 +399,29 @@ template<class Key, class Value>
 BinarySearchTree<Key, Value>::BinarySearchTree() 
 {
     root_ = NULL; 
+    leftmost_ = NULL;
+    rightmost_ = NULL;
+}
+
+/**
+* Deep copy. The structure is cloned node for node (see cloneFrom), so it
+* takes O(n) and compares no keys.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(const BinarySearchTree<Key, Value>& other) :
+    root_(NULL), leftmost_(NULL), rightmost_(NULL)
+{
+    cloneFrom(other);
+}
 
+/**
+* Takes over other's nodes in O(1), leaving other empty.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(BinarySearchTree<Key, Value>&& other) :
+    root_(other.root_), leftmost_(other.leftmost_), rightmost_(other.rightmost_)
+{
+    other.root_ = other.leftmost_ = other.rightmost_ = NULL;
 }
 
 template<typename Key, typename Value>
@@ -386,6 +430,38 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
     clear();
 }
 
+/**
+* Replaces the contents with a clone of other's. Nodes come from the
+* virtual createNode/cloneNode, so the tree keeps its own node type.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>&
+BinarySearchTree<Key, Value>::operator=(const BinarySearchTree<Key, Value>& other)
+{
+    if (this != &other) {
+        clear();
+        cloneFrom(other);
+    }
+    return *this;
+}
+
+/**
+* Frees the current contents and takes over other's nodes, leaving
+* other empty.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>&
+BinarySearchTree<Key, Value>::operator=(BinarySearchTree<Key, Value>&& other)
+{
+    if (this != &other) {
+        clear();
+        std::swap(root_, other.root_);
+        std::swap(leftmost_, other.leftmost_);
+        std::swap(rightmost_, other.rightmost_);
+    }
+    return *this;
+}
+
 /**
  * Returns true if tree is empty
 */
@@ -424,6 +500,26 @@ BinarySearchTree<Key, Value>::end() const
     return end;
 }
 
+/**
+* Returns an iterator to the smallest item (same as begin())
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::min() const
+{
+    return iterator(leftmost_);
+}
+
+/**
+* Returns an iterator to the largest item, or end() if the tree is empty
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::max() const
+{
+    return iterator(rightmost_);
+}
+
 /**
 * Returns an iterator to the item with the given key, k
 * or the end iterator if k does not exist in the tree
@@ -438,16 +534,19 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
 }
 
 /**
- * @precondition The key exists in the map
- * Returns the value associated with the key
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent (like std::map)
  */
 template<class Key, class Value>
 Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
 {
-    Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
-    return curr->getValue();
+    return find_or_insert(std::make_pair(key, Value())).first->second;
 }
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
 template<class Key, class Value>
 Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 {
@@ -456,42 +555,143 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
     return curr->getValue();
 }
 
+/**
+ * @precondition The tree is not empty
+ * Removes the smallest item and returns it. The cached leftmost node is
+ * unlinked directly, so there is no descent to find it again.
+ */
+template<class Key, class Value>
+std::pair<Key, Value> BinarySearchTree<Key, Value>::extract_min()
+{
+    if(leftmost_ == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(leftmost_->getKey(), leftmost_->getValue());
+    removeNode(leftmost_);
+    return item;
+}
+
+/**
+ * @precondition The tree is not empty
+ * Removes the largest item and returns it.
+ */
+template<class Key, class Value>
+std::pair<Key, Value> BinarySearchTree<Key, Value>::extract_max()
+{
+    if(rightmost_ == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(rightmost_->getKey(), rightmost_->getValue());
+    removeNode(rightmost_);
+    return item;
+}
+
 /**
 * An insert method to insert into a Binary Search Tree.
 * The tree will not remain balanced when inserting.
 * Recall: If key is already in the tree, you should 
 * overwrite the current value with the updated value.
+* Returns an iterator to the item and whether a new node was created.
 */
 template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair) // FINISHED
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair) // FINISHED
+{
+    std::pair<Node<Key, Value>*, bool> result = internalInsert(keyValuePair, true);
+    return std::make_pair(iterator(result.first), result.second);
+}
+
+/**
+* Inserts keyValuePair only if its key is absent. Either way returns an
+* iterator to the key's item (whose value is left untouched if it already
+* existed) and whether it was inserted. One descent serves both cases.
+*/
+template<class Key, class Value>
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+BinarySearchTree<Key, Value>::find_or_insert(const std::pair<const Key, Value> &keyValuePair)
+{
+    std::pair<Node<Key, Value>*, bool> result = internalInsert(keyValuePair, false);
+    return std::make_pair(iterator(result.first), result.second);
+}
+
+/**
+* Shared body of insert and find_or_insert. Descends once, either attaching
+* a new node or stopping at the existing one (whose value is replaced only
+* if overwrite is set). Returns the node and whether it is new.
+*/
+template<class Key, class Value>
+std::pair<Node<Key, Value>*, bool>
+BinarySearchTree<Key, Value>::internalInsert(const std::pair<const Key, Value> &keyValuePair, bool overwrite)
 {
     if (root_ == nullptr){
-        root_ = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
+        root_ = createNode(keyValuePair.first, keyValuePair.second, nullptr);
+        leftmost_ = root_;
+        rightmost_ = root_;
+        return std::make_pair(root_, true);
     }
-    else{
-        Node<Key, Value>* active = root_; 
-        Key aKey = keyValuePair.first; 
-        while (true){
-            if (active->getLeft() == nullptr && aKey < active->getKey()){
-                active->setLeft(new Node<Key, Value>(keyValuePair.first, keyValuePair.second, active)); 
-                break;
-            }
-            else if (active->getRight() == nullptr && aKey > active->getKey()){
-                active->setRight(new Node<Key, Value>(keyValuePair.first, keyValuePair.second, active)); 
-                break;
-            }
-            else if (active->getLeft() != nullptr && aKey < active->getKey()){
-                active = active->getLeft(); 
-            }
-            else if (active->getRight() != nullptr && aKey > active->getKey()){
-                active = active->getRight(); 
-            }
-            else {
-                active->setValue(keyValuePair.second);
-                break;
-            }
+    int dir;
+    Node<Key, Value>* active = descend(keyValuePair.first, dir); 
+    if (dir < 0){
+        if (overwrite){
+            active->setValue(keyValuePair.second);
+        }
+        return std::make_pair(active, false);
+    }
+    Node<Key, Value>* node = createNode(keyValuePair.first, keyValuePair.second, active);
+    if (dir == 0){
+        active->setLeft(node); 
+        if (active == leftmost_){
+            leftmost_ = node;
         }
     }
+    else {
+        active->setRight(node); 
+        if (active == rightmost_){
+            rightmost_ = node;
+        }
+    }
+    return std::make_pair(node, true);
+}
+
+/**
+* Allocates a node for the tree. Every node a tree creates comes from here
+* and goes back through destroyNode, so derived trees can use a different
+* node type or keep side structures in step with the node set.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new Node<Key, Value>(key, value, parent);
+}
+
+/**
+* Frees a node that has already been unlinked (or is being cleared).
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::destroyNode(Node<Key, Value>* node)
+{
+    delete node;
+}
+
+/**
+* Called once a removal (of one node, or of many by clear, a range erase or
+* a batch removal) has finished and the tree is consistent again. Does
+* nothing here; trees that keep state about removed keys catch up in it.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::afterRemoval()
+{
+
+}
+
+/**
+* Removes the item pos refers to without searching for its key again.
+* Returns an iterator to the item that followed it.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator pos)
+{
+    Node<Key, Value>* next = successor(pos.current_);
+    removeNode(pos.current_);
+    return iterator(next);
 }
 
 
@@ -503,8 +703,17 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key)
 {
-    Node<Key, Value>* foundKey = internalFind(key);
+    removeNode(internalFind(key));
+}
 
+/**
+* Unlinks and deletes a node already located in the tree (NULL is ignored).
+* Derived trees override this to rebalance afterwards; remove(key),
+* extract_min and extract_max all funnel through it.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* foundKey)
+{
     if (foundKey == nullptr) { // empty case
         return;
     }
@@ -514,6 +723,16 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         nodeSwap(foundKey, pred);
     }
 
+    // The extremes have at most one child so are never swapped. nodeSwap
+    // exchanges whole nodes, never items, so the cached pointers stay valid
+    // when either node it moves is an extreme.
+    if (foundKey == leftmost_) {
+        leftmost_ = successor(foundKey);
+    }
+    if (foundKey == rightmost_) {
+        rightmost_ = predecessor(foundKey);
+    }
+
     Node<Key, Value>* child = nullptr; // child since will only have one or zero child
     if (foundKey->getLeft() != nullptr) {
         child = foundKey->getLeft();
@@ -538,7 +757,8 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         child->setParent(parent);
     }
 
-    delete foundKey;
+    destroyNode(foundKey);
+    afterRemoval();
 }
 
 
@@ -571,6 +791,55 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current) // FINISHED
     }
 }
 
+/**
+* Returns the in-order successor of current, or NULL if current is the largest node.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+{
+    if (current == nullptr){
+        return nullptr; 
+    }
+
+    if (current->getRight() != nullptr){
+        Node<Key, Value>* active = current->getRight(); 
+        while (active->getLeft() != nullptr){
+            active = active->getLeft(); 
+        }
+        return active; 
+    }
+    else {
+        Node<Key, Value>* child = current;
+        Node<Key, Value>* parent = current->getParent();
+
+        while (parent != nullptr && parent->getRight() == child) {
+            child = parent;
+            parent = parent->getParent();
+        }
+
+        return parent; 
+    }
+}
+
+/**
+* Lets derived trees build an iterator from a node and read the node back
+* out of one; the iterator only befriends BinarySearchTree itself.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::makeIterator(Node<Key, Value>* node)
+{
+    return iterator(node);
+}
+
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::iteratorNode(const iterator& it)
+{
+    return it.current_;
+}
+
 /*
 HELPER METHOD FOR CLEAR. 
 */
@@ -583,11 +852,63 @@ void BinarySearchTree<Key, Value>::clearHelper(Node<Key, Value>* node)
     else{
         clearHelper(node->getLeft());
         clearHelper(node->getRight()); 
-        delete node; 
+        destroyNode(node); 
     }
 }
 
 
+/**
+* Creates a copy of source (key, value and whatever state the node type
+* carries) under parent.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    return createNode(source->getKey(), source->getValue(), parent);
+}
+
+/**
+* Fills an empty tree with a copy of other's structure in one preorder
+* walk over both trees at once. It follows parent links instead of
+* recursing, so even a degenerate tree needs no deep stack, and each node
+* is visited at most three times: O(n) with no key comparisons.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::cloneFrom(const BinarySearchTree<Key, Value>& other)
+{
+    const Node<Key, Value>* source = other.root_;
+    if (source == NULL) {
+        return;
+    }
+    Node<Key, Value>* copy = root_ = cloneNode(source, NULL);
+    while (true) {
+        if (source == other.leftmost_) {
+            leftmost_ = copy;
+        }
+        if (source == other.rightmost_) {
+            rightmost_ = copy;
+        }
+        if (source->getLeft() != NULL && copy->getLeft() == NULL) {
+            copy->setLeft(cloneNode(source->getLeft(), copy));
+            source = source->getLeft();
+            copy = copy->getLeft();
+        }
+        else if (source->getRight() != NULL && copy->getRight() == NULL) {
+            copy->setRight(cloneNode(source->getRight(), copy));
+            source = source->getRight();
+            copy = copy->getRight();
+        }
+        else if (source->getParent() != NULL) {
+            source = source->getParent();
+            copy = copy->getParent();
+        }
+        else {
+            return;
+        }
+    }
+}
+
 /**
 * A method to remove all contents of the tree and
 * reset the values in the tree for use again.
@@ -597,28 +918,21 @@ void BinarySearchTree<Key, Value>::clear()
 {
     clearHelper(root_); 
     root_ = nullptr;
+    leftmost_ = nullptr;
+    rightmost_ = nullptr;
+    afterRemoval();
 }
 
 
 /**
 * A helper function to find the smallest node in the tree.
+* The node is cached by insert/remove, so this is O(1).
 */
 template<typename Key, typename Value>
 Node<Key, Value>*
 BinarySearchTree<Key, Value>::getSmallestNode() const // FINISHED
 {
-    Node<Key, Value>* activeNode = root_; 
-    while (true){
-        if (activeNode == nullptr){
-            return NULL; 
-        }
-        if (activeNode->getLeft() != nullptr){
-            activeNode = activeNode->getLeft(); 
-        }
-        else {
-            return activeNode; 
-        }
-    }
+    return leftmost_;
 }
 
 /**
@@ -629,22 +943,71 @@ BinarySearchTree<Key, Value>::getSmallestNode() const // FINISHED
 template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const // FINISHED
 {
-    Node<Key, Value>* activeNode = root_; 
-    while (true){
-        if (activeNode == nullptr){
-            return NULL; 
+    int dir;
+    Node<Key, Value>* activeNode = descend(key, dir);
+    return dir < 0 ? activeNode : NULL;
+}
+
+/**
+* Shared search loop for lookups and insertions. Returns the node holding key
+* with dir set to -1, or else the node under whose empty left (dir 0) or
+* right (dir 1) link key belongs. Returns NULL for an empty tree.
+* Arithmetic keys index the next child by one comparison; everything else
+* compares with < both ways.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, int& dir) const
+{
+    return descend(key, dir, std::integral_constant<bool, std::is_arithmetic<Key>::value>());
+}
+
+/**
+* For arithmetic keys the next child is indexed by the result of a single <
+* instead of picked by a second branch. The equality test stays in the loop
+* but is almost never taken, so it predicts well and lets a hit stop at its
+* own node. getKey and getChild are non-virtual, so each step is two loads.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, int& dir, std::true_type) const
+{
+    Node<Key, Value>* parent = NULL;
+    Node<Key, Value>* activeNode = root_;
+    dir = -1;
+    while (activeNode != nullptr){
+        const Key activeKey = activeNode->getKey();
+        if (activeKey == key){
+            dir = -1;
+            return activeNode;
         }
-        Key activeKey = activeNode->getKey(); 
-        if (key == activeKey){
-            return activeNode; 
+        dir = activeKey < key;
+        parent = activeNode;
+        activeNode = activeNode->getChild(dir);
+    }
+    return parent;
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, int& dir, std::false_type) const
+{
+    Node<Key, Value>* parent = NULL;
+    Node<Key, Value>* activeNode = root_;
+    dir = -1;
+    while (activeNode != nullptr){
+        const Key& activeKey = activeNode->getKey();
+        if (key < activeKey){
+            dir = 0;
         }
-        else if (key < activeKey){
-            activeNode = activeNode->getLeft(); 
+        else if (activeKey < key){
+            dir = 1;
         }
         else {
-            activeNode = activeNode->getRight();
+            dir = -1;
+            return activeNode;
         }
+        parent = activeNode;
+        activeNode = activeNode->getChild(dir);
     }
+    return parent;
 }
 
 
@@ -696,6 +1059,40 @@ bool BinarySearchTree<Key, Value>::isBalanced() const
     }
 }
 
+/**
+* Returns the number of nodes on the longest root-to-leaf path (0 when
+* empty). Walks the whole tree along parent links, so it takes O(n) but
+* no stack, however degenerate the tree is.
+*/
+template<typename Key, typename Value>
+int BinarySearchTree<Key, Value>::height() const
+{
+    int height = 0;
+    int depth = 0;
+    Node<Key, Value>* prev = NULL;
+    Node<Key, Value>* node = root_;
+    while (node != NULL) {
+        Node<Key, Value>* next;
+        if (prev == node->getParent()) {
+            height = std::max(height, ++depth);
+            next = node->getLeft() != NULL ? node->getLeft()
+                 : node->getRight() != NULL ? node->getRight() : node->getParent();
+        }
+        else if (prev == node->getLeft() && node->getRight() != NULL) {
+            next = node->getRight();
+        }
+        else {
+            next = node->getParent();
+        }
+        if (next == node->getParent()) {
+            --depth;
+        }
+        prev = node;
+        node = next;
+    }
+    return height;
+}
+
 
 
 template<typename Key, typename Value>
@@ -0,0 +1,467 @@
+#ifndef CACHEAVL_H
+#define CACHEAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <unordered_map>
+#include "avlbst.h"
+
+/**
+* Which item a full CacheAVLTree gives up to make room for a new one.
+*/
+enum EvictionPolicy
+{
+    EVICT_LRU,       // the item least recently inserted or looked up
+    EVICT_SMALLEST,  // the item with the smallest key
+    EVICT_LARGEST    // the item with the largest key
+};
+
+template <typename Key, typename Value>
+class CacheAVLTree;
+
+/**
+* An AVLNode that is also an element of the cache's recency list, which
+* runs from the least recently used node (oldest) to the most recently
+* used (newest).
+*/
+template <typename Key, typename Value>
+class CacheNode : public AVLNode<Key, Value>
+{
+public:
+    CacheNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~CacheNode();
+
+protected:
+    friend class CacheAVLTree<Key, Value>;
+    CacheNode<Key, Value>* older_;
+    CacheNode<Key, Value>* newer_;
+};
+
+template<class Key, class Value>
+CacheNode<Key, Value>::CacheNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), older_(NULL), newer_(NULL)
+{
+
+}
+
+template<class Key, class Value>
+CacheNode<Key, Value>::~CacheNode()
+{
+
+}
+
+/**
+* An AVLTree that holds at most capacity() items, for use as an ordered
+* cache. Inserting a new key into a full tree evicts one other item, chosen
+* by the policy: the least recently used, or the one with the smallest or
+* largest key. The new item itself is never the one evicted.
+*
+* The nodes are threaded on an intrusive list in order of use. find,
+* operator[], find_or_insert and inserting a key that is already present
+* count as uses under EVICT_LRU and move the node to the newest end in
+* O(1); iteration does not. Since lookups change the list, even they must
+* not run concurrently with anything else.
+*
+* Eviction is a removeNode inside insert, so O(log n). The evicted node is
+* not freed but kept and constructed in place for the next new item, so a
+* full cache under a steady stream of inserts does not allocate.
+*
+* merge adds the other tree's items and then evicts by the policy until the
+* cache is back within capacity. compact moves the CacheNodes into its block
+* and keeps their order in the recency list.
+*/
+template <typename Key, typename Value>
+class CacheAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    explicit CacheAVLTree(size_t capacity, EvictionPolicy policy = EVICT_LRU);
+    CacheAVLTree(const CacheAVLTree& other);
+    CacheAVLTree(CacheAVLTree&& other);
+    virtual ~CacheAVLTree();
+    CacheAVLTree& operator=(const CacheAVLTree& other);
+    CacheAVLTree& operator=(CacheAVLTree&& other);
+
+    using AVLTree<Key, Value>::insert;
+    iterator insert(iterator hint, const std::pair<const Key, Value> &new_item);
+    size_t size() const;
+    size_t capacity() const;
+    void setCapacity(size_t capacity);
+    EvictionPolicy policy() const;
+
+protected:
+    virtual Node<Key, Value>* internalFind(const Key& key) const;
+    virtual std::pair<Node<Key, Value>*, bool> internalInsert(
+        const std::pair<const Key, Value> &new_item, bool overwrite);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void destroyNode(Node<Key, Value>* node);
+    virtual size_t nodeSize() const;
+    virtual AVLNode<Key, Value>* constructNode(void* slot, const Key& key, const Value& value,
+                                               AVLNode<Key, Value>* parent);
+    virtual void relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to);
+    virtual size_t mergeWith(const AVLTree<Key, Value>& other,
+                             const typename AVLTree<Key, Value>::Resolver& resolve);
+    void unlink(CacheNode<Key, Value>* node) const;
+    void pushNewest(CacheNode<Key, Value>* node) const;
+    void touch(Node<Key, Value>* node) const;
+    void evictOverflow(Node<Key, Value>* keep);
+    void copyRecency(const CacheAVLTree& other);
+
+    size_t capacity_;
+    EvictionPolicy policy_;
+    size_t size_;
+    mutable CacheNode<Key, Value>* oldest_;
+    mutable CacheNode<Key, Value>* newest_;
+    void* spare_;  // an evicted heap node's memory, kept for the next createNode
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the CacheAVLTree class.
+  ---------------------------------------------
+*/
+
+template<class Key, class Value>
+CacheAVLTree<Key, Value>::CacheAVLTree(size_t capacity, EvictionPolicy policy) :
+    capacity_(capacity), policy_(policy), size_(0), oldest_(NULL), newest_(NULL), spare_(NULL)
+{
+    if (capacity == 0) {
+        throw std::invalid_argument("CacheAVLTree capacity must be positive");
+    }
+}
+
+/**
+* The copy has other's capacity, policy and recency order.
+*/
+template<class Key, class Value>
+CacheAVLTree<Key, Value>::CacheAVLTree(const CacheAVLTree& other) :
+    AVLTree<Key, Value>(), capacity_(other.capacity_), policy_(other.policy_),
+    size_(0), oldest_(NULL), newest_(NULL), spare_(NULL)
+{
+    this->cloneFrom(other);
+    copyRecency(other);
+}
+
+/**
+* other keeps its capacity and policy but is left empty.
+*/
+template<class Key, class Value>
+CacheAVLTree<Key, Value>::CacheAVLTree(CacheAVLTree&& other) :
+    AVLTree<Key, Value>(std::move(other)), capacity_(other.capacity_), policy_(other.policy_),
+    size_(other.size_), oldest_(other.oldest_), newest_(other.newest_), spare_(NULL)
+{
+    other.size_ = 0;
+    other.oldest_ = other.newest_ = NULL;
+}
+
+/**
+* Clears here, while destroyNode still is this class's, so that the nodes
+* leave the list and the last one freed is kept as the spare.
+*/
+template<class Key, class Value>
+CacheAVLTree<Key, Value>::~CacheAVLTree()
+{
+    this->clear();
+    ::operator delete(spare_);
+}
+
+template<class Key, class Value>
+CacheAVLTree<Key, Value>& CacheAVLTree<Key, Value>::operator=(const CacheAVLTree& other)
+{
+    if (this != &other) {
+        AVLTree<Key, Value>::operator=(other);
+        capacity_ = other.capacity_;
+        policy_ = other.policy_;
+        copyRecency(other);
+    }
+    return *this;
+}
+
+/**
+* The base class frees this tree's nodes first, which empties the list,
+* so other is left with an empty list to match its empty tree.
+*/
+template<class Key, class Value>
+CacheAVLTree<Key, Value>& CacheAVLTree<Key, Value>::operator=(CacheAVLTree&& other)
+{
+    if (this != &other) {
+        AVLTree<Key, Value>::operator=(std::move(other));
+        capacity_ = other.capacity_;
+        policy_ = other.policy_;
+        size_ = other.size_;
+        oldest_ = other.oldest_;
+        newest_ = other.newest_;
+        other.size_ = 0;
+        other.oldest_ = other.newest_ = NULL;
+    }
+    return *this;
+}
+
+/**
+* Threads a fresh clone of other onto the list in other's order. The two
+* trees have the same shape, so walking both in order pairs each node with
+* its copy.
+*/
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::copyRecency(const CacheAVLTree& other)
+{
+    std::unordered_map<const Node<Key, Value>*, CacheNode<Key, Value>*> copies;
+    copies.reserve(size_);
+    Node<Key, Value>* copy = this->leftmost_;
+    for (Node<Key, Value>* source = other.leftmost_; source != NULL; source = this->successor(source)) {
+        copies[source] = static_cast<CacheNode<Key, Value>*>(copy);
+        copy = this->successor(copy);
+    }
+    oldest_ = newest_ = NULL;
+    for (CacheNode<Key, Value>* source = other.oldest_; source != NULL; source = source->newer_) {
+        pushNewest(copies[source]);
+    }
+}
+
+template<class Key, class Value>
+size_t CacheAVLTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value>
+size_t CacheAVLTree<Key, Value>::capacity() const
+{
+    return capacity_;
+}
+
+template<class Key, class Value>
+EvictionPolicy CacheAVLTree<Key, Value>::policy() const
+{
+    return policy_;
+}
+
+/**
+* Changes the capacity, evicting items by the policy until they fit.
+*/
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::setCapacity(size_t capacity)
+{
+    if (capacity == 0) {
+        throw std::invalid_argument("CacheAVLTree capacity must be positive");
+    }
+    capacity_ = capacity;
+    evictOverflow(NULL);
+}
+
+/**
+* Inserts as AVLTree does, then counts the insert as a use of the node if
+* the key was present, or evicts if the new node overfilled the tree.
+*/
+template<class Key, class Value>
+typename CacheAVLTree<Key, Value>::iterator
+CacheAVLTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &new_item)
+{
+    iterator it = AVLTree<Key, Value>::insert(hint, new_item);
+    Node<Key, Value>* node = this->iteratorNode(it);
+    touch(node);
+    evictOverflow(node);
+    return it;
+}
+
+/**
+* A lookup that finds its key counts as a use.
+*/
+template<class Key, class Value>
+Node<Key, Value>* CacheAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    Node<Key, Value>* node = AVLTree<Key, Value>::internalFind(key);
+    if (node != NULL) {
+        touch(node);
+    }
+    return node;
+}
+
+/**
+* New nodes are already the newest, so only a key that was present needs
+* touching. A new node may overfill the tree, and is kept out of the
+* eviction so the caller gets it back.
+*/
+template<class Key, class Value>
+std::pair<Node<Key, Value>*, bool>
+CacheAVLTree<Key, Value>::internalInsert(const std::pair<const Key, Value> &new_item, bool overwrite)
+{
+    std::pair<Node<Key, Value>*, bool> result = AVLTree<Key, Value>::internalInsert(new_item, overwrite);
+    if (result.second) {
+        evictOverflow(result.first);
+    }
+    else {
+        touch(result.first);
+    }
+    return result;
+}
+
+/**
+* Removes items by the policy, skipping keep, until the tree is within
+* its capacity. Each removal is O(log n).
+*/
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::evictOverflow(Node<Key, Value>* keep)
+{
+    while (size_ > capacity_) {
+        Node<Key, Value>* victim;
+        if (policy_ == EVICT_LRU) {
+            victim = oldest_ != keep ? oldest_ : oldest_->newer_;
+        }
+        else if (policy_ == EVICT_SMALLEST) {
+            victim = this->leftmost_ != keep ? this->leftmost_ : this->successor(keep);
+        }
+        else {
+            victim = this->rightmost_ != keep ? this->rightmost_ : this->predecessor(keep);
+        }
+        this->removeNode(victim);
+    }
+}
+
+/**
+* Merges as AVLTree does, then evicts until the cache is within its
+* capacity again. The new items are the newest, so under EVICT_LRU the
+* existing ones go first; items whose value was only resolved keep their
+* place in the recency list. While the merge runs the tree may hold up to
+* n + m items. Returns how many keys were new, including any that were
+* evicted again.
+*/
+template<class Key, class Value>
+size_t CacheAVLTree<Key, Value>::mergeWith(const AVLTree<Key, Value>& other,
+                                           const typename AVLTree<Key, Value>::Resolver& resolve)
+{
+    size_t added = AVLTree<Key, Value>::mergeWith(other, resolve);
+    evictOverflow(NULL);
+    return added;
+}
+
+/**
+* Reuses the spare node's memory when there is one, and otherwise takes
+* a slot from AVLTree, which builds the node through constructNode.
+*/
+template<class Key, class Value>
+Node<Key, Value>* CacheAVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    CacheNode<Key, Value>* node;
+    if (spare_ != NULL) {
+        node = static_cast<CacheNode<Key, Value>*>(
+            constructNode(spare_, key, value, static_cast<AVLNode<Key, Value>*>(parent)));
+        spare_ = NULL;
+    }
+    else {
+        node = static_cast<CacheNode<Key, Value>*>(AVLTree<Key, Value>::createNode(key, value, parent));
+    }
+    pushNewest(node);
+    ++size_;
+    return node;
+}
+
+/**
+* Destroys the node in place and keeps its memory as the spare, unless
+* there already is one or the node lives in the compacted block, whose
+* free slots AVLTree reuses anyway.
+*/
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::destroyNode(Node<Key, Value>* node)
+{
+    CacheNode<Key, Value>* cacheNode = static_cast<CacheNode<Key, Value>*>(node);
+    unlink(cacheNode);
+    --size_;
+    if (spare_ == NULL && !this->inArena(cacheNode)) {
+        cacheNode->~CacheNode<Key, Value>();
+        spare_ = cacheNode;
+    }
+    else {
+        AVLTree<Key, Value>::destroyNode(cacheNode);
+    }
+}
+
+template<class Key, class Value>
+size_t CacheAVLTree<Key, Value>::nodeSize() const
+{
+    return sizeof(CacheNode<Key, Value>);
+}
+
+template<class Key, class Value>
+AVLNode<Key, Value>* CacheAVLTree<Key, Value>::constructNode(void* slot, const Key& key, const Value& value,
+                                                             AVLNode<Key, Value>* parent)
+{
+    return new (slot) CacheNode<Key, Value>(key, value, parent);
+}
+
+/**
+* Puts the copy in from's place in the recency list. The neighbours have
+* moved too, and each old node's parent link leads to its copy.
+*/
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to)
+{
+    CacheNode<Key, Value>* source = static_cast<CacheNode<Key, Value>*>(from);
+    CacheNode<Key, Value>* copy = static_cast<CacheNode<Key, Value>*>(to);
+    copy->older_ = source->older_ != NULL ? static_cast<CacheNode<Key, Value>*>(source->older_->getParent()) : NULL;
+    copy->newer_ = source->newer_ != NULL ? static_cast<CacheNode<Key, Value>*>(source->newer_->getParent()) : NULL;
+    if (oldest_ == source) {
+        oldest_ = copy;
+    }
+    if (newest_ == source) {
+        newest_ = copy;
+    }
+}
+
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::unlink(CacheNode<Key, Value>* node) const
+{
+    if (node->older_ != NULL) {
+        node->older_->newer_ = node->newer_;
+    }
+    else {
+        oldest_ = node->newer_;
+    }
+    if (node->newer_ != NULL) {
+        node->newer_->older_ = node->older_;
+    }
+    else {
+        newest_ = node->older_;
+    }
+}
+
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::pushNewest(CacheNode<Key, Value>* node) const
+{
+    node->older_ = newest_;
+    node->newer_ = NULL;
+    if (newest_ != NULL) {
+        newest_->newer_ = node;
+    }
+    else {
+        oldest_ = node;
+    }
+    newest_ = node;
+}
+
+/**
+* Moves the node to the newest end of the list under EVICT_LRU. The other
+* policies keep insertion order, which nothing reads.
+*/
+template<class Key, class Value>
+void CacheAVLTree<Key, Value>::touch(Node<Key, Value>* node) const
+{
+    CacheNode<Key, Value>* cacheNode = static_cast<CacheNode<Key, Value>*>(node);
+    if (policy_ == EVICT_LRU && cacheNode != newest_) {
+        unlink(cacheNode);
+        pushNewest(cacheNode);
+    }
+}
+
+/*
+  -------------------------------------------
+  End implementations for the CacheAVLTree class.
+  -------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,487 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <functional>
+#include "bst.h"
+#include "avlbst.h"
+#include <runtime_evaluator.h>
+#include <random_generator.h>
+
+using namespace std;
+
+/*
+ * Complexity regression checks for the public operations of
+ * BinarySearchTree and AVLTree, run by `make complexity`. Each check
+ * builds a tree of n items (untimed), then measures one operation, or a
+ * batch of BATCH of them for the cheap ones. It is measured twice:
+ *
+ * - timed with the task-clock timer from the test archive, on int keys.
+ *   RuntimeEvaluator fits the times over n = 2^6 to 2^16 and the check
+ *   fails if the fit finds a worse class and not the expected one. Timing
+ *   is noisy, so the fit is tried up to ATTEMPTS times.
+ * - counted, on keys that count their comparisons, at n = 2^10 and 2^18.
+ *   The counts are exact, which catches what the fit cannot: it takes
+ *   O(n log n) for O(n). An O(log n) operation may do at most
+ *   LOG_GROWTH times as many comparisons at the larger size, and an O(n)
+ *   one at most LINEAR_GROWTH times as many per item.
+ *
+ * BinarySearchTree is filled in balanced order, so its O(log n) checks
+ * hold too. The parallel scans are left out because the task clock only
+ * counts the calling thread.
+ */
+
+typedef RuntimeEvaluator::TimeComplexity Complexity;
+
+static const int BATCH = 64;
+static const int ATTEMPTS = 3;
+static const int SMALL_LOG2 = 10;
+static const int LARGE_LOG2 = 18;
+static const int TIMED_LOG2 = 16;
+static const double LOG_GROWTH = 4;
+static const double LINEAR_GROWTH = 1.5;
+
+// Results are summed into a global so the compiler cannot drop the timed
+// calls.
+long sink = 0;
+
+/**
+ * An int key that counts the comparisons made on it.
+ */
+struct Counted
+{
+    static uint64_t comparisons;
+    int value;
+
+    Counted(int v = 0) : value(v) {}
+};
+
+uint64_t Counted::comparisons = 0;
+
+bool operator<(const Counted& a, const Counted& b)
+{
+    ++Counted::comparisons;
+    return a.value < b.value;
+}
+
+ostream& operator<<(ostream& out, const Counted& key)
+{
+    return out << key.value;
+}
+
+/**
+ * What a check measures between its construction and stop(): task-clock
+ * time for int keys, comparisons for Counted ones.
+ */
+template <typename Key>
+class Probe;
+
+template <>
+class Probe<int>
+{
+public:
+    void stop() { timer_.stop(); }
+    uint64_t result() { return timer_.getTime(); }
+
+private:
+    BenchmarkTimer timer_;
+};
+
+template <>
+class Probe<Counted>
+{
+public:
+    Probe() : start_(Counted::comparisons), count_(0) {}
+    void stop() { count_ = Counted::comparisons - start_; }
+    uint64_t result() const { return count_; }
+
+private:
+    uint64_t start_;
+    uint64_t count_;
+};
+
+/**
+ * Inserts the keys 0, 2, ..., 2(n-1) in preorder of the balanced tree on
+ * them, which leaves even an unbalanced tree perfectly balanced. Odd keys
+ * are free for the checks to insert.
+ */
+template <typename Tree>
+void fillBalanced(Tree& tree, int lo, int hi)
+{
+    if (lo >= hi) {
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    tree.insert(std::make_pair(2 * mid, mid));
+    fillBalanced(tree, lo, mid);
+    fillBalanced(tree, mid + 1, hi);
+}
+
+template <typename Tree>
+void fill(Tree& tree, uint64_t n)
+{
+    fillBalanced(tree, 0, (int)n);
+}
+
+static int randomKey(mt19937& rng, uint64_t n)
+{
+    return 2 * (int)(rng() % n);
+}
+
+/**
+ * A check on one tree type: fn gets a tree of n items and a seeded
+ * generator and returns the time taken by the operations it timed.
+ */
+template <typename Tree>
+struct Check
+{
+    const char* name;
+    Complexity expected;
+    function<uint64_t(Tree&, uint64_t, mt19937&)> fn;
+};
+
+static const char* complexityName(Complexity c)
+{
+    switch (c) {
+    case Complexity::CONSTANT: return "O(1)";
+    case Complexity::LOGARITHMIC: return "O(log n)";
+    case Complexity::LINEAR: return "O(n)";
+    case Complexity::LINEARITHMIC: return "O(n log n)";
+    default: return "O(n^2) or worse";
+    }
+}
+
+/**
+ * Fits the timings of the check and returns false if every attempt fits
+ * them to a worse class than expected and not to the expected one. The
+ * evaluator's output goes to log.
+ */
+template <typename Tree>
+bool timed(const string& name, const Check<Tree>& check, ostringstream& log)
+{
+    for (int attempt = 0; attempt < ATTEMPTS; ++attempt) {
+        RuntimeEvaluator evaluator(name, 6, TIMED_LOG2, 10, [&](uint64_t n, RandomSeed seed) {
+            Tree tree;
+            fill(tree, n);
+            mt19937 rng(seed);
+            return check.fn(tree, n, rng);
+        });
+        evaluator.setCorrelationThreshold(1.4);
+        streambuf* saved = cout.rdbuf(log.rdbuf());
+        evaluator.evaluate();
+        cout.rdbuf(saved);
+        // Only a fit to a worse class fails: the cheapest operations time
+        // at the noise floor, where often no class fits at all.
+        if (evaluator.meetsComplexity(check.expected) || !evaluator.meetsComplexity(Complexity::CUBIC)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Compares the comparison counts of the check at the two sizes and
+ * returns whether their growth fits its expected class, explaining a
+ * failure in log.
+ */
+template <typename Tree>
+bool counted(const Check<Tree>& check, ostringstream& log)
+{
+    uint64_t counts[2];
+    uint64_t sizes[2] = { (uint64_t)1 << SMALL_LOG2, (uint64_t)1 << LARGE_LOG2 };
+    for (int i = 0; i < 2; ++i) {
+        Tree tree;
+        fill(tree, sizes[i]);
+        mt19937 rng(1);
+        counts[i] = check.fn(tree, sizes[i], rng);
+    }
+    // One is added so that operations without comparisons pass.
+    double growth = (double)(counts[1] + 1) / (counts[0] + 1);
+    double limit = check.expected == Complexity::LOGARITHMIC
+        ? LOG_GROWTH : LINEAR_GROWTH * sizes[1] / sizes[0];
+    if (growth > limit) {
+        log << "Comparisons: " << counts[0] << " at n = 2^" << SMALL_LOG2 << ", "
+            << counts[1] << " at n = 2^" << LARGE_LOG2 << " (allowed growth " << limit << "x)" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Runs both measurements of a check and prints one line for it, followed
+ * by the details when it fails.
+ */
+template <typename Tree, typename CountedTree>
+bool run(const char* treeName, const Check<Tree>& check, const Check<CountedTree>& countedCheck)
+{
+    string name = string(treeName) + "::" + check.name;
+    ostringstream log;
+    bool met = counted(countedCheck, log) && timed(name, check, log);
+    cout << (met ? "ok     " : "FAILED ") << name << " is " << (met ? "" : "not ")
+         << complexityName(check.expected) << endl;
+    if (!met) {
+        cout << log.str();
+    }
+    return met;
+}
+
+/**
+ * Checks shared by both trees.
+ */
+template <typename Key, typename Tree>
+vector<Check<Tree> > commonChecks()
+{
+    typedef typename Tree::iterator iterator;
+    Check<Tree> checks[] = {
+        { "insert", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                t.insert(std::make_pair(randomKey(rng, n) + 1, i));
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "remove", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                t.remove(randomKey(rng, n));
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "find", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                sink += t.find(randomKey(rng, n))->second;
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "operator[]", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                sink += t[randomKey(rng, n)];
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "find_or_insert", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                sink += t.find_or_insert(std::make_pair(randomKey(rng, n) + (int)(rng() % 2), i)).second;
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "erase(iterator)", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            vector<iterator> targets;
+            for (int i = 0; i < BATCH; ++i) {
+                iterator it = t.find(2 * (int)((n / BATCH) * i + rng() % (n / BATCH)));
+                targets.push_back(it);
+            }
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                t.erase(targets[i]);
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "extract_min/max", Complexity::LOGARITHMIC, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH / 2; ++i) {
+                sink += t.extract_min().second + t.extract_max().second;
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "begin/min/max/empty", Complexity::LOGARITHMIC, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                sink += t.begin()->second + t.min()->second + t.max()->second + t.empty();
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "iterator++ (one step)", Complexity::LOGARITHMIC, [](Tree& t, uint64_t n, mt19937& rng) {
+            vector<iterator> starts;
+            for (int i = 0; i < BATCH; ++i) {
+                starts.push_back(t.find(randomKey(rng, n)));
+            }
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                sink += ++starts[i] != t.end();
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "iteration", Complexity::LINEAR, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            for (iterator it = t.begin(); it != t.end(); ++it) {
+                sink += it->second;
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "clear", Complexity::LINEAR, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            t.clear();
+            probe.stop();
+            return probe.result();
+        } },
+        { "isBalanced", Complexity::LINEAR, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            sink += t.isBalanced();
+            probe.stop();
+            return probe.result();
+        } },
+        { "copy", Complexity::LINEAR, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            Tree copy(t);
+            probe.stop();
+            sink += copy.empty();
+            return probe.result();
+        } },
+        { "copy assignment", Complexity::LINEAR, [](Tree& t, uint64_t, mt19937&) {
+            Tree copy;
+            Probe<Key> probe;
+            copy = t;
+            probe.stop();
+            sink += copy.empty();
+            return probe.result();
+        } },
+        { "move", Complexity::LOGARITHMIC, [](Tree& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            Tree moved(std::move(t));
+            t = std::move(moved);
+            probe.stop();
+            return probe.result();
+        } },
+    };
+    return vector<Check<Tree> >(checks, checks + sizeof(checks) / sizeof(checks[0]));
+}
+
+template <typename Key>
+vector<Check<BinarySearchTree<Key, int> > > bstChecks()
+{
+    typedef BinarySearchTree<Key, int> BST;
+    vector<Check<BST> > checks = commonChecks<Key, BST>();
+    Check<BST> height = { "height", Complexity::LINEAR, [](BST& t, uint64_t, mt19937&) {
+        Probe<Key> probe;
+        sink += t.height();
+        probe.stop();
+        return probe.result();
+    } };
+    checks.push_back(height);
+    return checks;
+}
+
+template <typename Key>
+vector<Check<AVLTree<Key, int> > > avlChecks()
+{
+    typedef AVLTree<Key, int> AVL;
+    typedef typename AVL::iterator iterator;
+    vector<Check<AVL> > checks = commonChecks<Key, AVL>();
+    Check<AVL> more[] = {
+        { "height", Complexity::LOGARITHMIC, [](AVL& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                sink += t.height();
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "insert (ascending)", Complexity::LOGARITHMIC, [](AVL& t, uint64_t n, mt19937&) {
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                t.insert(std::make_pair(2 * (int)n + i, i));
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "insert(hint)", Complexity::LOGARITHMIC, [](AVL& t, uint64_t n, mt19937& rng) {
+            vector<iterator> hints;
+            vector<int> keys;
+            for (int i = 0; i < BATCH; ++i) {
+                keys.push_back(randomKey(rng, n) + 1);
+                hints.push_back(t.find(keys.back() + 1));
+            }
+            Probe<Key> probe;
+            for (int i = 0; i < BATCH; ++i) {
+                t.insert(hints[i], std::make_pair(keys[i], i));
+            }
+            probe.stop();
+            return probe.result();
+        } },
+        { "erase(lo, hi) of BATCH keys", Complexity::LOGARITHMIC, [](AVL& t, uint64_t n, mt19937& rng) {
+            int lo = 2 * (int)(rng() % (n - BATCH + 1));
+            Probe<Key> probe;
+            sink += t.erase(lo, lo + 2 * BATCH);
+            probe.stop();
+            return probe.result();
+        } },
+        { "erase(lo, hi) of half", Complexity::LINEAR, [](AVL& t, uint64_t n, mt19937&) {
+            Probe<Key> probe;
+            sink += t.erase((int)n / 2, 3 * (int)n / 2);
+            probe.stop();
+            return probe.result();
+        } },
+        { "remove_batch of BATCH keys", Complexity::LOGARITHMIC, [](AVL& t, uint64_t n, mt19937& rng) {
+            vector<Key> keys;
+            for (int i = 0; i < BATCH; ++i) {
+                keys.push_back(randomKey(rng, n));
+            }
+            Probe<Key> probe;
+            sink += t.remove_batch(keys);
+            probe.stop();
+            return probe.result();
+        } },
+        { "merge of BATCH keys", Complexity::LOGARITHMIC, [](AVL& t, uint64_t n, mt19937& rng) {
+            AVL delta;
+            for (int i = 0; i < BATCH; ++i) {
+                delta.insert(std::make_pair(randomKey(rng, n) + 1, i));
+            }
+            Probe<Key> probe;
+            sink += t.merge(delta);
+            probe.stop();
+            return probe.result();
+        } },
+        { "merge of an equal-size tree", Complexity::LINEAR, [](AVL& t, uint64_t n, mt19937&) {
+            AVL other;
+            fill(other, n);
+            Probe<Key> probe;
+            sink += t.merge(other);
+            probe.stop();
+            return probe.result();
+        } },
+        { "compact", Complexity::LINEAR, [](AVL& t, uint64_t, mt19937&) {
+            Probe<Key> probe;
+            t.compact();
+            probe.stop();
+            return probe.result();
+        } },
+    };
+    checks.insert(checks.end(), more, more + sizeof(more) / sizeof(more[0]));
+    return checks;
+}
+
+int main()
+{
+    int failed = 0;
+    vector<Check<BinarySearchTree<int, int> > > bst = bstChecks<int>();
+    vector<Check<BinarySearchTree<Counted, int> > > bstCounted = bstChecks<Counted>();
+    for (size_t i = 0; i < bst.size(); ++i) {
+        failed += !run("BinarySearchTree", bst[i], bstCounted[i]);
+    }
+    vector<Check<AVLTree<int, int> > > avl = avlChecks<int>();
+    vector<Check<AVLTree<Counted, int> > > avlCounted = avlChecks<Counted>();
+    for (size_t i = 0; i < avl.size(); ++i) {
+        failed += !run("AVLTree", avl[i], avlCounted[i]);
+    }
+    if (failed > 0) {
+        cout << failed << " complexity check(s) failed" << endl;
+        return 1;
+    }
+    cout << "All complexity checks passed" << endl;
+    return 0;
+}
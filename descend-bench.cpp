@@ -0,0 +1,108 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+
+using namespace std;
+
+/*
+ * Compares the indexed-child descent BinarySearchTree uses for arithmetic
+ * keys with the three-way descent every other key type takes. The same
+ * random 64-bit keys go into an AVLTree<uint64_t, int> and into an
+ * AVLTree keyed by a wrapper that only defines operator<, so the two trees
+ * have the same shape and differ only in how they walk it.
+ */
+
+static size_t KEYS = 1 << 20;
+// Lookups are timed over this many passes and the fastest is reported,
+// which filters out other load on the machine.
+static const int PASSES = 5;
+
+// Lookup results are summed into a global so the compiler cannot move
+// the timed loops past the clock reads.
+long found = 0;
+
+struct Boxed {
+    uint64_t value;
+    Boxed(uint64_t v = 0) : value(v) { }
+    bool operator<(const Boxed& other) const { return value < other.value; }
+};
+
+ostream& operator<<(ostream& out, const Boxed& key)
+{
+    return out << key.value;
+}
+
+static double nsPerOp(chrono::steady_clock::time_point start, size_t ops)
+{
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count() / ops;
+}
+
+template <typename K>
+void run(ostream& out, const char* name, const vector<uint64_t>& keys,
+         const vector<uint64_t>& lookups, const vector<uint64_t>& misses)
+{
+    AVLTree<K, int> tree;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(K(keys[i]), (int)i));
+    }
+    double insertNs = nsPerOp(start, keys.size());
+
+    double hitNs = 0, missNs = 0;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            found += tree.find(K(lookups[i]))->second;
+        }
+        double ns = nsPerOp(start, lookups.size());
+        hitNs = pass == 0 ? ns : min(hitNs, ns);
+
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < misses.size(); ++i) {
+            found += tree.find(K(misses[i])) != tree.end();
+        }
+        ns = nsPerOp(start, misses.size());
+        missNs = pass == 0 ? ns : min(missNs, ns);
+    }
+
+    out << setw(20) << name << fixed << setprecision(1)
+         << setw(10) << insertNs << setw(10) << hitNs
+         << setw(10) << missNs << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        KEYS = strtoul(argv[1], NULL, 10);
+    }
+    mt19937_64 rng(7);
+    vector<uint64_t> keys, misses;
+    for (size_t i = 0; i < KEYS; ++i) {
+        // Even keys go in, odd keys miss.
+        keys.push_back(rng() & ~uint64_t(1));
+        misses.push_back(rng() | 1);
+    }
+    // Look keys up in a different order from the one they went in.
+    vector<uint64_t> shuffled(keys);
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    // Rows are collected and printed at the end: setting up cout before the
+    // trees are built moves where their nodes land and skews the timings.
+    ostringstream table;
+    run<uint64_t>(table, "indexed", keys, shuffled, misses);
+    run<Boxed>(table, "three-way", keys, shuffled, misses);
+
+    cout << KEYS << " random 64-bit keys, ns per operation" << endl;
+    cout << setw(20) << "" << setw(10) << "insert" << setw(10) << "hit"
+         << setw(10) << "miss" << endl;
+    cout << table.str();
+    return 0;
+}
@@ -0,0 +1,165 @@
+#ifndef HASHAVL_H
+#define HASHAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include "avlbst.h"
+#include "hashindex.h"
+
+/**
+* An AVLTree with a hash index from key to node kept alongside it. Point
+* lookups (find, operator[], remove's search and the existing-key case of
+* insert) go straight through the index in expected O(1); ordered
+* iteration and everything else is the plain AVL tree.
+*
+* The index is updated from the createNode/destroyNode hooks, so every path
+* that adds or frees a node keeps it consistent, and compact's moves are
+* followed through relocateNode. Rotations and nodeSwap move whole nodes
+* around without changing which node holds which key, so they need no index
+* updates at all.
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class HashedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    HashedAVLTree();
+    HashedAVLTree(const HashedAVLTree& other);
+    HashedAVLTree(HashedAVLTree&& other);
+    HashedAVLTree& operator=(const HashedAVLTree& other);
+    HashedAVLTree& operator=(HashedAVLTree&& other);
+
+protected:
+    /**
+    * Reads a node's key for the index.
+    */
+    struct NodeKey
+    {
+        const Key& operator()(const Node<Key, Value>* node) const { return node->getKey(); }
+    };
+
+    virtual Node<Key, Value>* internalFind(const Key& key) const;
+    virtual std::pair<Node<Key, Value>*, bool> internalInsert(
+        const std::pair<const Key, Value> &new_item, bool overwrite);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void destroyNode(Node<Key, Value>* node);
+    virtual void relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to);
+
+    HashIndex<Key, Node<Key, Value>, NodeKey, Hash> index_;
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the HashedAVLTree class.
+  ---------------------------------------------
+*/
+
+template<class Key, class Value, class Hash>
+HashedAVLTree<Key, Value, Hash>::HashedAVLTree()
+{
+
+}
+
+/**
+* The clone goes through this class's createNode, which indexes every
+* copied node as it is made.
+*/
+template<class Key, class Value, class Hash>
+HashedAVLTree<Key, Value, Hash>::HashedAVLTree(const HashedAVLTree& other) :
+    AVLTree<Key, Value>()
+{
+    this->cloneFrom(other);
+}
+
+template<class Key, class Value, class Hash>
+HashedAVLTree<Key, Value, Hash>::HashedAVLTree(HashedAVLTree&& other) :
+    AVLTree<Key, Value>(std::move(other))
+{
+    index_.swap(other.index_);
+}
+
+/**
+* Clearing unindexes the old nodes and cloning indexes the new ones, so
+* the index needs no separate copy.
+*/
+template<class Key, class Value, class Hash>
+HashedAVLTree<Key, Value, Hash>& HashedAVLTree<Key, Value, Hash>::operator=(const HashedAVLTree& other)
+{
+    AVLTree<Key, Value>::operator=(other);
+    return *this;
+}
+
+/**
+* After the base class has freed this tree's nodes the index is empty,
+* so swapping leaves other with an empty index to match its empty tree.
+*/
+template<class Key, class Value, class Hash>
+HashedAVLTree<Key, Value, Hash>& HashedAVLTree<Key, Value, Hash>::operator=(HashedAVLTree&& other)
+{
+    if (this != &other) {
+        AVLTree<Key, Value>::operator=(std::move(other));
+        index_.swap(other.index_);
+    }
+    return *this;
+}
+
+/**
+* Looks the key up in the index instead of descending the tree.
+*/
+template<class Key, class Value, class Hash>
+Node<Key, Value>* HashedAVLTree<Key, Value, Hash>::internalFind(const Key& key) const
+{
+    return index_.find(key);
+}
+
+/**
+* Resolves keys that are already present through the index; only new
+* keys descend the tree to find their place.
+*/
+template<class Key, class Value, class Hash>
+std::pair<Node<Key, Value>*, bool>
+HashedAVLTree<Key, Value, Hash>::internalInsert(const std::pair<const Key, Value> &new_item, bool overwrite)
+{
+    Node<Key, Value>* existing = index_.find(new_item.first);
+    if (existing != NULL) {
+        if (overwrite) {
+            existing->setValue(new_item.second);
+        }
+        return std::make_pair(existing, false);
+    }
+    return AVLTree<Key, Value>::internalInsert(new_item, overwrite);
+}
+
+template<class Key, class Value, class Hash>
+Node<Key, Value>* HashedAVLTree<Key, Value, Hash>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    Node<Key, Value>* node = AVLTree<Key, Value>::createNode(key, value, parent);
+    index_.insert(node);
+    return node;
+}
+
+template<class Key, class Value, class Hash>
+void HashedAVLTree<Key, Value, Hash>::destroyNode(Node<Key, Value>* node)
+{
+    index_.erase(node);
+    AVLTree<Key, Value>::destroyNode(node);
+}
+
+/**
+* The copy takes over the old node's slot in the index.
+*/
+template<class Key, class Value, class Hash>
+void HashedAVLTree<Key, Value, Hash>::relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to)
+{
+    index_.replace(from, to);
+}
+
+/*
+  -------------------------------------------
+  End implementations for the HashedAVLTree class.
+  -------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+* An open-addressing hash table of pointers to items that carry their own key
+* (tree nodes, for instance). Keys are not copied: each slot holds the item
+* pointer and the key's mixed hash, and KeyOf reads the key back out of the
+* item when the hashes match. Collisions are resolved by linear probing and
+* erase uses backward-shift deletion, so there are no tombstones.
+*
+* KeyOf must provide: const Key& operator()(const T* item) const
+*/
+template <typename Key, typename T, typename KeyOf, typename Hash = std::hash<Key> >
+class HashIndex
+{
+public:
+    HashIndex();
+
+    T* find(const Key& key) const;
+    void insert(T* item);
+    void erase(T* item);
+    void replace(T* item, T* with);
+    void clear();
+    void swap(HashIndex& other);
+    size_t size() const;
+
+protected:
+    struct Slot
+    {
+        uint64_t hash;
+        T* item;    // NULL marks an empty slot
+    };
+
+    uint64_t hashOf(const Key& key) const;
+    size_t home(uint64_t hash) const;
+    void rehash(size_t capacity);
+
+    std::vector<Slot> slots_;
+    size_t size_;
+    unsigned shift_;    // 64 - log2(capacity)
+    Hash hash_;
+    KeyOf keyOf_;
+};
+
+/*
+  ------------------------------------------
+  Begin implementations for the HashIndex class.
+  ------------------------------------------
+*/
+
+template<class Key, class T, class KeyOf, class Hash>
+HashIndex<Key, T, KeyOf, Hash>::HashIndex() :
+    size_(0), shift_(64)
+{
+
+}
+
+template<class Key, class T, class KeyOf, class Hash>
+size_t HashIndex<Key, T, KeyOf, Hash>::size() const
+{
+    return size_;
+}
+
+/**
+* Scrambles the user hash (std::hash of an integer is the integer itself)
+* with a Fibonacci multiply so that the top bits pick the slot.
+*/
+template<class Key, class T, class KeyOf, class Hash>
+uint64_t HashIndex<Key, T, KeyOf, Hash>::hashOf(const Key& key) const
+{
+    return static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+}
+
+template<class Key, class T, class KeyOf, class Hash>
+size_t HashIndex<Key, T, KeyOf, Hash>::home(uint64_t hash) const
+{
+    return shift_ == 64 ? 0 : static_cast<size_t>(hash >> shift_);
+}
+
+/**
+* Returns the item with the given key, or NULL.
+*/
+template<class Key, class T, class KeyOf, class Hash>
+T* HashIndex<Key, T, KeyOf, Hash>::find(const Key& key) const
+{
+    if (size_ == 0) {
+        return NULL;
+    }
+    uint64_t h = hashOf(key);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = home(h); slots_[i].item != NULL; i = (i + 1) & mask) {
+        if (slots_[i].hash == h && keyOf_(slots_[i].item) == key) {
+            return slots_[i].item;
+        }
+    }
+    return NULL;
+}
+
+/**
+* Adds an item whose key is not already present. The table doubles
+* before the load factor would pass 3/4.
+*/
+template<class Key, class T, class KeyOf, class Hash>
+void HashIndex<Key, T, KeyOf, Hash>::insert(T* item)
+{
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+        rehash(slots_.empty() ? 16 : slots_.size() * 2);
+    }
+    uint64_t h = hashOf(keyOf_(item));
+    size_t mask = slots_.size() - 1;
+    size_t i = home(h);
+    while (slots_[i].item != NULL) {
+        i = (i + 1) & mask;
+    }
+    slots_[i].hash = h;
+    slots_[i].item = item;
+    ++size_;
+}
+
+/**
+* Removes exactly this item (NULL or absent items are ignored), then
+* pulls later members of the probe run back over the hole.
+*/
+template<class Key, class T, class KeyOf, class Hash>
+void HashIndex<Key, T, KeyOf, Hash>::erase(T* item)
+{
+    if (item == NULL || size_ == 0) {
+        return;
+    }
+    size_t mask = slots_.size() - 1;
+    size_t i = home(hashOf(keyOf_(item)));
+    while (slots_[i].item != item) {
+        if (slots_[i].item == NULL) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (slots_[j].item == NULL) {
+            break;
+        }
+        // The entry at j may fill the hole at i unless its home lies
+        // cyclically within (i, j].
+        size_t k = home(slots_[j].hash);
+        bool inRange = (i < j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!inRange) {
+            slots_[i] = slots_[j];
+            i = j;
+        }
+    }
+    slots_[i].item = NULL;
+    --size_;
+}
+
+/**
+* Points item's slot at with, which must carry an equal key, without
+* moving anything. Absent items are ignored.
+*/
+template<class Key, class T, class KeyOf, class Hash>
+void HashIndex<Key, T, KeyOf, Hash>::replace(T* item, T* with)
+{
+    if (item == NULL || size_ == 0) {
+        return;
+    }
+    size_t mask = slots_.size() - 1;
+    for (size_t i = home(hashOf(keyOf_(item))); slots_[i].item != NULL; i = (i + 1) & mask) {
+        if (slots_[i].item == item) {
+            slots_[i].item = with;
+            return;
+        }
+    }
+}
+
+template<class Key, class T, class KeyOf, class Hash>
+void HashIndex<Key, T, KeyOf, Hash>::clear()
+{
+    slots_.clear();
+    size_ = 0;
+    shift_ = 64;
+}
+
+template<class Key, class T, class KeyOf, class Hash>
+void HashIndex<Key, T, KeyOf, Hash>::swap(HashIndex& other)
+{
+    slots_.swap(other.slots_);
+    std::swap(size_, other.size_);
+    std::swap(shift_, other.shift_);
+}
+
+/**
+* Moves every item into a table of the given power-of-two capacity.
+*/
+template<class Key, class T, class KeyOf, class Hash>
+void HashIndex<Key, T, KeyOf, Hash>::rehash(size_t capacity)
+{
+    std::vector<Slot> old;
+    old.swap(slots_);
+    Slot empty = { 0, NULL };
+    slots_.assign(capacity, empty);
+    shift_ = 64;
+    for (size_t c = capacity; c > 1; c >>= 1) {
+        --shift_;
+    }
+    size_t mask = capacity - 1;
+    for (size_t s = 0; s < old.size(); ++s) {
+        if (old[s].item == NULL) {
+            continue;
+        }
+        size_t i = home(old[s].hash);
+        while (slots_[i].item != NULL) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = old[s];
+    }
+}
+
+/*
+  ----------------------------------------
+  End implementations for the HashIndex class.
+  ----------------------------------------
+*/
+
+#endif
@@ -0,0 +1,376 @@
+#ifndef INDEXAVL_H
+#define INDEXAVL_H
+
+#include <cstdint>
+#include <utility>
+
+/**
+* The AVL algorithms shared by the trees whose nodes link to each other by
+* 32-bit slot indices instead of pointers: PooledAVLTree, whose slots are
+* in a vector, and SharedAVLTree, whose slots are in a shared-memory
+* segment. Only where the slots and the root live differs, so the tree
+* passes itself in as Derived and provides
+*
+*   slot(idx)     the node in slot idx (const and non-const), with index
+*                 members parent, left and right and an int8_t balance
+*                 (right height minus left height);
+*   slotKey(idx)  the key stored in slot idx;
+*   rootIndex()   the root's index, by reference in the non-const version;
+*   freeNode(idx) releases a slot that removeNode has unlinked.
+*
+* Derived makes this class a friend so it can reach them. The calls are
+* resolved at compile time, so there is no virtual dispatch on the hot
+* paths.
+*/
+template <typename Derived, typename Key>
+class IndexedAVL
+{
+public:
+    typedef uint32_t index_type;
+    static const index_type NIL = 0xFFFFFFFFu;
+
+protected:
+    Derived& self();
+    const Derived& self() const;
+
+    index_type internalFind(const Key& key) const;
+    index_type getSmallestNode() const;
+    index_type successor(index_type current) const;
+    index_type predecessor(index_type current) const;
+    void attachFix(index_type child);
+    void removeNode(index_type found);
+    void replaceChild(index_type parent, index_type oldChild, index_type newChild);
+    void nodeSwap(index_type n1, index_type n2);
+    index_type rotateLeft(index_type x);
+    index_type rotateRight(index_type x);
+    index_type rebalance(index_type z);
+};
+
+template<class Derived, class Key>
+const typename IndexedAVL<Derived, Key>::index_type IndexedAVL<Derived, Key>::NIL;
+
+/*
+  -----------------------------------------------
+  Begin implementations for the IndexedAVL class.
+  -----------------------------------------------
+*/
+
+template<class Derived, class Key>
+Derived& IndexedAVL<Derived, Key>::self()
+{
+    return static_cast<Derived&>(*this);
+}
+
+template<class Derived, class Key>
+const Derived& IndexedAVL<Derived, Key>::self() const
+{
+    return static_cast<const Derived&>(*this);
+}
+
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::internalFind(const Key& key) const
+{
+    index_type active = self().rootIndex();
+    while (active != NIL) {
+        const Key& activeKey = self().slotKey(active);
+        if (key < activeKey) {
+            active = self().slot(active).left;
+        }
+        else if (activeKey < key) {
+            active = self().slot(active).right;
+        }
+        else {
+            return active;
+        }
+    }
+    return NIL;
+}
+
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::getSmallestNode() const
+{
+    index_type active = self().rootIndex();
+    if (active == NIL) {
+        return NIL;
+    }
+    while (self().slot(active).left != NIL) {
+        active = self().slot(active).left;
+    }
+    return active;
+}
+
+/**
+* Returns the in-order successor of current, or NIL.
+*/
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::successor(index_type current) const
+{
+    const Derived& tree = self();
+    if (tree.slot(current).right != NIL) {
+        index_type active = tree.slot(current).right;
+        while (tree.slot(active).left != NIL) {
+            active = tree.slot(active).left;
+        }
+        return active;
+    }
+    index_type child = current;
+    index_type parent = tree.slot(current).parent;
+    while (parent != NIL && tree.slot(parent).right == child) {
+        child = parent;
+        parent = tree.slot(parent).parent;
+    }
+    return parent;
+}
+
+/**
+* Returns the in-order predecessor of a node that has a left child.
+*/
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::predecessor(index_type current) const
+{
+    index_type active = self().slot(current).left;
+    while (self().slot(active).right != NIL) {
+        active = self().slot(active).right;
+    }
+    return active;
+}
+
+/**
+* Walks up from child, a slot just linked under its parent, updating
+* balances, and performs at most one (single or double) rotation.
+*/
+template<class Derived, class Key>
+void IndexedAVL<Derived, Key>::attachFix(index_type child)
+{
+    Derived& tree = self();
+    index_type parent = tree.slot(child).parent;
+    while (parent != NIL) {
+        tree.slot(parent).balance += (tree.slot(parent).left == child) ? -1 : 1;
+        if (tree.slot(parent).balance == 0) {
+            break;
+        }
+        if (tree.slot(parent).balance == 2 || tree.slot(parent).balance == -2) {
+            rebalance(parent);
+            break; // A rotation always finishes the balancing for insert
+        }
+        child = parent;
+        parent = tree.slot(parent).parent;
+    }
+}
+
+/**
+* Unlinks a located slot (NIL is ignored), hands it to freeNode and
+* rebalances. A slot with two children first trades places with its
+* predecessor.
+*/
+template<class Derived, class Key>
+void IndexedAVL<Derived, Key>::removeNode(index_type found)
+{
+    if (found == NIL) {
+        return;
+    }
+    Derived& tree = self();
+
+    if (tree.slot(found).left != NIL && tree.slot(found).right != NIL) {
+        nodeSwap(found, predecessor(found));
+    }
+
+    index_type child = (tree.slot(found).left != NIL) ? tree.slot(found).left : tree.slot(found).right;
+    index_type parent = tree.slot(found).parent;
+    int8_t diff = 0;
+    if (parent != NIL) {
+        diff = (tree.slot(parent).left == found) ? 1 : -1;
+    }
+    replaceChild(parent, found, child);
+    if (child != NIL) {
+        tree.slot(child).parent = parent;
+    }
+    tree.freeNode(found);
+
+    index_type curr = parent;
+    while (curr != NIL) {
+        tree.slot(curr).balance += diff;
+        if (tree.slot(curr).balance == 1 || tree.slot(curr).balance == -1) {
+            break;
+        }
+        if (tree.slot(curr).balance == 2 || tree.slot(curr).balance == -2) {
+            curr = rebalance(curr);
+            if (tree.slot(curr).balance != 0) {
+                break; // Height stabilized
+            }
+        }
+        index_type nextParent = tree.slot(curr).parent;
+        if (nextParent != NIL) {
+            diff = (tree.slot(nextParent).left == curr) ? 1 : -1;
+        }
+        curr = nextParent;
+    }
+}
+
+/**
+* Points parent's link that referred to oldChild at newChild instead
+* (or the root, if parent is NIL).
+*/
+template<class Derived, class Key>
+void IndexedAVL<Derived, Key>::replaceChild(index_type parent, index_type oldChild, index_type newChild)
+{
+    if (parent == NIL) {
+        self().rootIndex() = newChild;
+    }
+    else if (self().slot(parent).left == oldChild) {
+        self().slot(parent).left = newChild;
+    }
+    else {
+        self().slot(parent).right = newChild;
+    }
+}
+
+/**
+* Exchanges the tree positions (links and balance) of two slots, the index
+* counterpart of BinarySearchTree::nodeSwap.
+*/
+template<class Derived, class Key>
+void IndexedAVL<Derived, Key>::nodeSwap(index_type n1, index_type n2)
+{
+    if (n1 == n2 || n1 == NIL || n2 == NIL) {
+        return;
+    }
+    Derived& tree = self();
+    auto& a = tree.slot(n1);
+    auto& b = tree.slot(n2);
+    index_type n1p = a.parent;
+    index_type n2p = b.parent;
+    bool n1isLeft = (n1p != NIL && tree.slot(n1p).left == n1);
+    bool n2isLeft = (n2p != NIL && tree.slot(n2p).left == n2);
+
+    std::swap(a.parent, b.parent);
+    std::swap(a.left, b.left);
+    std::swap(a.right, b.right);
+    std::swap(a.balance, b.balance);
+
+    // Adjacent nodes now point at themselves; turn those links around.
+    if (a.parent == n1) a.parent = n2;
+    if (b.parent == n2) b.parent = n1;
+    if (a.left == n1) a.left = n2;
+    if (a.right == n1) a.right = n2;
+    if (b.left == n2) b.left = n1;
+    if (b.right == n2) b.right = n1;
+
+    if (n1p != NIL && n1p != n2) {
+        if (n1isLeft) tree.slot(n1p).left = n2;
+        else tree.slot(n1p).right = n2;
+    }
+    if (n2p != NIL && n2p != n1) {
+        if (n2isLeft) tree.slot(n2p).left = n1;
+        else tree.slot(n2p).right = n1;
+    }
+    if (a.left != NIL && a.left != n2) tree.slot(a.left).parent = n1;
+    if (a.right != NIL && a.right != n2) tree.slot(a.right).parent = n1;
+    if (b.left != NIL && b.left != n1) tree.slot(b.left).parent = n2;
+    if (b.right != NIL && b.right != n1) tree.slot(b.right).parent = n2;
+
+    index_type& root = tree.rootIndex();
+    if (root == n1) {
+        root = n2;
+    }
+    else if (root == n2) {
+        root = n1;
+    }
+}
+
+/**
+* Rotates x's right child up into x's place. Returns the new subtree root.
+* Balances are left for the caller to fix.
+*/
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::rotateLeft(index_type x)
+{
+    Derived& tree = self();
+    index_type y = tree.slot(x).right;
+    index_type t = tree.slot(y).left;
+    tree.slot(x).right = t;
+    if (t != NIL) tree.slot(t).parent = x;
+    tree.slot(y).parent = tree.slot(x).parent;
+    replaceChild(tree.slot(x).parent, x, y);
+    tree.slot(y).left = x;
+    tree.slot(x).parent = y;
+    return y;
+}
+
+/**
+* Mirror image of rotateLeft.
+*/
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::rotateRight(index_type x)
+{
+    Derived& tree = self();
+    index_type y = tree.slot(x).left;
+    index_type t = tree.slot(y).right;
+    tree.slot(x).left = t;
+    if (t != NIL) tree.slot(t).parent = x;
+    tree.slot(y).parent = tree.slot(x).parent;
+    replaceChild(tree.slot(x).parent, x, y);
+    tree.slot(y).right = x;
+    tree.slot(x).parent = y;
+    return y;
+}
+
+/**
+* Restores the AVL property at z, whose balance has reached +2 or -2.
+* Returns the root of the rebalanced subtree; its balance is 0 iff
+* the subtree got shorter.
+*/
+template<class Derived, class Key>
+typename IndexedAVL<Derived, Key>::index_type
+IndexedAVL<Derived, Key>::rebalance(index_type z)
+{
+    Derived& tree = self();
+    if (tree.slot(z).balance == 2) {
+        index_type c = tree.slot(z).right;
+        if (tree.slot(c).balance >= 0) { // RR (or R0 during removal)
+            rotateLeft(z);
+            if (tree.slot(c).balance == 0) { tree.slot(z).balance = 1; tree.slot(c).balance = -1; }
+            else { tree.slot(z).balance = 0; tree.slot(c).balance = 0; }
+            return c;
+        }
+        index_type g = tree.slot(c).left; // RL
+        rotateRight(c);
+        rotateLeft(z);
+        if (tree.slot(g).balance == -1) { tree.slot(z).balance = 0; tree.slot(c).balance = 1; }
+        else if (tree.slot(g).balance == 1) { tree.slot(z).balance = -1; tree.slot(c).balance = 0; }
+        else { tree.slot(z).balance = 0; tree.slot(c).balance = 0; }
+        tree.slot(g).balance = 0;
+        return g;
+    }
+    else {
+        index_type c = tree.slot(z).left;
+        if (tree.slot(c).balance <= 0) { // LL (or L0 during removal)
+            rotateRight(z);
+            if (tree.slot(c).balance == 0) { tree.slot(z).balance = -1; tree.slot(c).balance = 1; }
+            else { tree.slot(z).balance = 0; tree.slot(c).balance = 0; }
+            return c;
+        }
+        index_type g = tree.slot(c).right; // LR
+        rotateLeft(c);
+        rotateRight(z);
+        if (tree.slot(g).balance == 1) { tree.slot(z).balance = 0; tree.slot(c).balance = -1; }
+        else if (tree.slot(g).balance == -1) { tree.slot(z).balance = 1; tree.slot(c).balance = 0; }
+        else { tree.slot(z).balance = 0; tree.slot(c).balance = 0; }
+        tree.slot(g).balance = 0;
+        return g;
+    }
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the IndexedAVL class.
+  ---------------------------------------------
+*/
+
+#endif
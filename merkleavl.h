@@ -0,0 +1,411 @@
+#ifndef MERKLEAVL_H
+#define MERKLEAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+
+template <typename Key, typename Value, typename Hash, typename ValueHash>
+class MerkleAVLTree;
+
+/**
+* An AVLNode that carries the hash of its own item and of its whole
+* subtree.
+*/
+template <typename Key, typename Value>
+class MerkleNode : public AVLNode<Key, Value>
+{
+public:
+    MerkleNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, uint64_t itemHash);
+    virtual ~MerkleNode();
+
+    uint64_t getItemHash() const;
+    uint64_t getSubtreeHash() const;
+
+protected:
+    template <typename K, typename V, typename H, typename VH> friend class MerkleAVLTree;
+    uint64_t itemHash_;
+    uint64_t subtreeHash_;
+};
+
+template<class Key, class Value>
+MerkleNode<Key, Value>::MerkleNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, uint64_t itemHash) :
+    AVLNode<Key, Value>(key, value, parent), itemHash_(itemHash), subtreeHash_(itemHash)
+{
+
+}
+
+template<class Key, class Value>
+MerkleNode<Key, Value>::~MerkleNode()
+{
+
+}
+
+template<class Key, class Value>
+uint64_t MerkleNode<Key, Value>::getItemHash() const
+{
+    return itemHash_;
+}
+
+template<class Key, class Value>
+uint64_t MerkleNode<Key, Value>::getSubtreeHash() const
+{
+    return subtreeHash_;
+}
+
+/**
+* An AVLTree that keeps a hash of each subtree's items, for comparing and
+* syncing replicas. Each item is hashed on its own and a subtree's hash is
+* the sum (mod 2^64) of its items' hashes. The sum does not depend on the
+* tree's shape, so the hash of any key range can be read from either of two
+* trees in O(log n) by descending to its bounds, however differently the
+* trees were built. diff walks this tree and skips every subtree whose
+* hash matches the same key range in the other one; for d differing keys
+* it costs O(d log^2 n), not O(n).
+*
+* The hashes are kept up to date through AVLTree's subtree hooks: each
+* rotation and join relinks the nodes it moves, and each insertion,
+* removal or value change updates the path above it in O(log n). Values
+* changed through a reference (operator[], iterators) are not seen; call
+* refresh on the item afterwards.
+*
+* The sum of 64-bit item hashes guards against accidental collisions, not
+* against items crafted to collide. compact moves the MerkleNodes into its
+* block with their stored hashes, so it rehashes nothing.
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename ValueHash = std::hash<Value> >
+class MerkleAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    MerkleAVLTree();
+    MerkleAVLTree(const MerkleAVLTree& other);
+    MerkleAVLTree(MerkleAVLTree&& other);
+    MerkleAVLTree& operator=(const MerkleAVLTree& other);
+    MerkleAVLTree& operator=(MerkleAVLTree&& other);
+
+    uint64_t rootHash() const;
+    void refresh(iterator it);
+    template <typename Fn>
+    size_t diff(const MerkleAVLTree& other, Fn fn) const;
+    size_t sync(const MerkleAVLTree& other);
+
+protected:
+    virtual size_t nodeSize() const;
+    virtual AVLNode<Key, Value>* constructNode(void* slot, const Key& key, const Value& value,
+                                               AVLNode<Key, Value>* parent);
+    virtual void relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+    virtual void updateSubtree(AVLNode<Key, Value>* node);
+    virtual void updatePath(AVLNode<Key, Value>* node);
+    virtual void assignValue(AVLNode<Key, Value>* node, const Value& value);
+
+    uint64_t itemHash(const Key& key, const Value& value) const;
+    static uint64_t mix(uint64_t x);
+    static uint64_t subtreeHash(const Node<Key, Value>* node);
+    uint64_t hashBelow(const Key& key, bool inclusive) const;
+    uint64_t rangeHash(const Key* lo, const Key* hi) const;
+    template <typename Fn>
+    void diffRange(const Node<Key, Value>* node, const Key* lo, const Key* hi,
+                   const MerkleAVLTree& other, Fn& fn, size_t& count) const;
+    template <typename Fn>
+    void reportRange(const Key* lo, const Key* hi, Fn& fn, size_t& count) const;
+
+    Hash hash_;
+    ValueHash valueHash_;
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the MerkleAVLTree class.
+  ---------------------------------------------
+*/
+
+template<class Key, class Value, class Hash, class ValueHash>
+MerkleAVLTree<Key, Value, Hash, ValueHash>::MerkleAVLTree()
+{
+
+}
+
+/**
+* The clone takes each subtree hash from its source node, since the
+* structure is copied as it is.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+MerkleAVLTree<Key, Value, Hash, ValueHash>::MerkleAVLTree(const MerkleAVLTree& other) :
+    AVLTree<Key, Value>(), hash_(other.hash_), valueHash_(other.valueHash_)
+{
+    this->cloneFrom(other);
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+MerkleAVLTree<Key, Value, Hash, ValueHash>::MerkleAVLTree(MerkleAVLTree&& other) :
+    AVLTree<Key, Value>(std::move(other)), hash_(other.hash_), valueHash_(other.valueHash_)
+{
+
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+MerkleAVLTree<Key, Value, Hash, ValueHash>&
+MerkleAVLTree<Key, Value, Hash, ValueHash>::operator=(const MerkleAVLTree& other)
+{
+    AVLTree<Key, Value>::operator=(other);
+    return *this;
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+MerkleAVLTree<Key, Value, Hash, ValueHash>&
+MerkleAVLTree<Key, Value, Hash, ValueHash>::operator=(MerkleAVLTree&& other)
+{
+    AVLTree<Key, Value>::operator=(std::move(other));
+    return *this;
+}
+
+/**
+* Returns the hash of all the items, 0 for an empty tree. Two trees with
+* the same items have the same hash.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+uint64_t MerkleAVLTree<Key, Value, Hash, ValueHash>::rootHash() const
+{
+    return subtreeHash(this->root_);
+}
+
+/**
+* Rehashes the item after its value was changed through a reference.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::refresh(iterator it)
+{
+    MerkleNode<Key, Value>* node = static_cast<MerkleNode<Key, Value>*>(this->iteratorNode(it));
+    node->itemHash_ = itemHash(node->getKey(), node->getValue());
+    updatePath(node);
+}
+
+/**
+* Calls fn(key, mine, theirs) in key order for each key whose item differs
+* between this tree and other, and returns how many there were. mine and
+* theirs point to the two values, or are NULL for a key missing from that
+* tree.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+template <typename Fn>
+size_t MerkleAVLTree<Key, Value, Hash, ValueHash>::diff(const MerkleAVLTree& other, Fn fn) const
+{
+    size_t count = 0;
+    diffRange(this->root_, NULL, NULL, other, fn, count);
+    return count;
+}
+
+/**
+* Makes this tree's items equal to other's by inserting, replacing and
+* removing only the items that differ. Returns how many that was.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+size_t MerkleAVLTree<Key, Value, Hash, ValueHash>::sync(const MerkleAVLTree& other)
+{
+    std::vector<std::pair<Key, const Value*> > changes;
+    diff(other, [&changes](const Key& key, const Value*, const Value* theirs) {
+        changes.push_back(std::make_pair(key, theirs));
+    });
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (changes[i].second == NULL) {
+            this->remove(changes[i].first);
+        }
+        else {
+            this->insert(std::make_pair(changes[i].first, *changes[i].second));
+        }
+    }
+    return changes.size();
+}
+
+/**
+* Compares the items of this subtree, which are exactly this tree's items
+* strictly between lo and hi (NULL for no bound), with other's items in
+* the same range, and recurses only if their hashes differ.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+template <typename Fn>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::diffRange(const Node<Key, Value>* node, const Key* lo, const Key* hi,
+                                                           const MerkleAVLTree& other, Fn& fn, size_t& count) const
+{
+    if (subtreeHash(node) == other.rangeHash(lo, hi)) {
+        return;
+    }
+    if (node == NULL) {
+        other.reportRange(lo, hi, fn, count);
+        return;
+    }
+    const Key& key = node->getKey();
+    diffRange(node->getLeft(), lo, &key, other, fn, count);
+    const MerkleNode<Key, Value>* mine = static_cast<const MerkleNode<Key, Value>*>(node);
+    const MerkleNode<Key, Value>* theirs = static_cast<const MerkleNode<Key, Value>*>(other.internalFind(key));
+    if (theirs == NULL) {
+        fn(key, &mine->getValue(), static_cast<const Value*>(NULL));
+        ++count;
+    }
+    else if (theirs->itemHash_ != mine->itemHash_) {
+        fn(key, &mine->getValue(), &theirs->getValue());
+        ++count;
+    }
+    diffRange(node->getRight(), &key, hi, other, fn, count);
+}
+
+/**
+* Reports each item strictly between lo and hi as missing from the other
+* tree, with fn(key, NULL, value).
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+template <typename Fn>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::reportRange(const Key* lo, const Key* hi, Fn& fn, size_t& count) const
+{
+    Node<Key, Value>* first = NULL;
+    if (lo == NULL) {
+        first = this->leftmost_;
+    }
+    else {
+        for (Node<Key, Value>* node = this->root_; node != NULL; ) {
+            if (*lo < node->getKey()) {
+                first = node;
+                node = node->getLeft();
+            }
+            else {
+                node = node->getRight();
+            }
+        }
+    }
+    for (Node<Key, Value>* node = first; node != NULL && (hi == NULL || node->getKey() < *hi);
+         node = this->successor(node)) {
+        fn(node->getKey(), static_cast<const Value*>(NULL), &node->getValue());
+        ++count;
+    }
+}
+
+/**
+* Returns the hash of the items with keys below key, or at most key if
+* inclusive is set, in one descent.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+uint64_t MerkleAVLTree<Key, Value, Hash, ValueHash>::hashBelow(const Key& key, bool inclusive) const
+{
+    uint64_t sum = 0;
+    Node<Key, Value>* node = this->root_;
+    while (node != NULL) {
+        if (node->getKey() < key || (inclusive && !(key < node->getKey()))) {
+            sum += subtreeHash(node->getLeft()) + static_cast<MerkleNode<Key, Value>*>(node)->itemHash_;
+            node = node->getRight();
+        }
+        else {
+            node = node->getLeft();
+        }
+    }
+    return sum;
+}
+
+/**
+* Returns the hash of the items strictly between lo and hi, where NULL
+* means no bound.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+uint64_t MerkleAVLTree<Key, Value, Hash, ValueHash>::rangeHash(const Key* lo, const Key* hi) const
+{
+    uint64_t upper = hi != NULL ? hashBelow(*hi, false) : rootHash();
+    uint64_t lower = lo != NULL ? hashBelow(*lo, true) : 0;
+    return upper - lower;
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+uint64_t MerkleAVLTree<Key, Value, Hash, ValueHash>::subtreeHash(const Node<Key, Value>* node)
+{
+    return node != NULL ? static_cast<const MerkleNode<Key, Value>*>(node)->subtreeHash_ : 0;
+}
+
+/**
+* The splitmix64 finalizer, so that items whose key and value hashes
+* differ in a few bits still get unrelated hashes.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+uint64_t MerkleAVLTree<Key, Value, Hash, ValueHash>::mix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+uint64_t MerkleAVLTree<Key, Value, Hash, ValueHash>::itemHash(const Key& key, const Value& value) const
+{
+    return mix(mix(static_cast<uint64_t>(hash_(key))) + static_cast<uint64_t>(valueHash_(value)));
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+size_t MerkleAVLTree<Key, Value, Hash, ValueHash>::nodeSize() const
+{
+    return sizeof(MerkleNode<Key, Value>);
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+AVLNode<Key, Value>* MerkleAVLTree<Key, Value, Hash, ValueHash>::constructNode(void* slot, const Key& key, const Value& value,
+                                                                              AVLNode<Key, Value>* parent)
+{
+    return new (slot) MerkleNode<Key, Value>(key, value, parent, itemHash(key, value));
+}
+
+/**
+* The copy takes both stored hashes as they are instead of rehashing its
+* item, so the subtree sums stay consistent with the item hashes even for
+* values changed through a reference and not yet refreshed.
+*/
+template<class Key, class Value, class Hash, class ValueHash>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::relocateNode(AVLNode<Key, Value>* from, AVLNode<Key, Value>* to)
+{
+    MerkleNode<Key, Value>* source = static_cast<MerkleNode<Key, Value>*>(from);
+    MerkleNode<Key, Value>* copy = static_cast<MerkleNode<Key, Value>*>(to);
+    copy->itemHash_ = source->itemHash_;
+    copy->subtreeHash_ = source->subtreeHash_;
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+Node<Key, Value>* MerkleAVLTree<Key, Value, Hash, ValueHash>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    MerkleNode<Key, Value>* copy = static_cast<MerkleNode<Key, Value>*>(AVLTree<Key, Value>::cloneNode(source, parent));
+    copy->subtreeHash_ = subtreeHash(source);
+    return copy;
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::updateSubtree(AVLNode<Key, Value>* node)
+{
+    MerkleNode<Key, Value>* merkle = static_cast<MerkleNode<Key, Value>*>(node);
+    merkle->subtreeHash_ = merkle->itemHash_ + subtreeHash(node->getLeft()) + subtreeHash(node->getRight());
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::updatePath(AVLNode<Key, Value>* node)
+{
+    for (; node != NULL; node = node->getParent()) {
+        updateSubtree(node);
+    }
+}
+
+template<class Key, class Value, class Hash, class ValueHash>
+void MerkleAVLTree<Key, Value, Hash, ValueHash>::assignValue(AVLNode<Key, Value>* node, const Value& value)
+{
+    node->setValue(value);
+    static_cast<MerkleNode<Key, Value>*>(node)->itemHash_ = itemHash(node->getKey(), value);
+}
+
+/*
+  -------------------------------------------
+  End implementations for the MerkleAVLTree class.
+  -------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef MULTIAVL_H
+#define MULTIAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* An AVLTree that allows duplicate keys, each occurrence in a node of its
+* own. Equal keys sit next to each other in insertion order, as in
+* std::multimap, so equal_range is a pair of O(log n) descents and needs no
+* container per key.
+*
+* insert always adds a node. find, operator[] and find_or_insert work on
+* the first occurrence of a key; erase(iterator) removes one occurrence and
+* remove(key) all of them. merge adds every item of the other tree as a
+* new occurrence, so its resolve function is never called.
+*/
+template <typename Key, typename Value>
+class AVLMultiTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    using AVLTree<Key, Value>::insert;
+    iterator insert(iterator hint, const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+    virtual size_t remove_batch(const std::vector<Key>& keys);
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    std::pair<iterator, iterator> equal_range(const Key& key) const;
+    size_t count(const Key& key) const;
+
+protected:
+    virtual Node<Key, Value>* internalFind(const Key& key) const;
+    virtual std::pair<Node<Key, Value>*, bool> internalInsert(
+        const std::pair<const Key, Value> &new_item, bool overwrite);
+    virtual size_t mergeWith(const AVLTree<Key, Value>& other,
+                             const typename AVLTree<Key, Value>::Resolver& resolve);
+    Node<Key, Value>* lowerBoundNode(const Key& key) const;
+    Node<Key, Value>* upperBoundNode(const Key& key) const;
+    size_t removeAll(const Key& key);
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the AVLMultiTree class.
+  ---------------------------------------------
+*/
+
+/**
+* Returns the first node with a key not below key, or NULL.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLMultiTree<Key, Value>::lowerBoundNode(const Key& key) const
+{
+    Node<Key, Value>* bound = NULL;
+    Node<Key, Value>* node = this->root_;
+    while (node != NULL) {
+        if (node->getKey() < key) {
+            node = node->getRight();
+        }
+        else {
+            bound = node;
+            node = node->getLeft();
+        }
+    }
+    return bound;
+}
+
+/**
+* Returns the first node with a key above key, or NULL.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLMultiTree<Key, Value>::upperBoundNode(const Key& key) const
+{
+    Node<Key, Value>* bound = NULL;
+    Node<Key, Value>* node = this->root_;
+    while (node != NULL) {
+        if (key < node->getKey()) {
+            bound = node;
+            node = node->getLeft();
+        }
+        else {
+            node = node->getRight();
+        }
+    }
+    return bound;
+}
+
+/**
+* Finds the first occurrence of key. The descent cannot stop at the first
+* equal node it meets, since earlier occurrences may be in its left subtree.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLMultiTree<Key, Value>::internalFind(const Key& key) const
+{
+    Node<Key, Value>* node = lowerBoundNode(key);
+    if (node == NULL || key < node->getKey()) {
+        return NULL;
+    }
+    return node;
+}
+
+/**
+* With overwrite set (insert) always attaches a new node, after any
+* existing occurrences of the key. Without it (find_or_insert and
+* operator[]) an existing occurrence is returned instead, unchanged.
+*/
+template<class Key, class Value>
+std::pair<Node<Key, Value>*, bool>
+AVLMultiTree<Key, Value>::internalInsert(const std::pair<const Key, Value> &new_item, bool overwrite)
+{
+    if (!overwrite) {
+        Node<Key, Value>* existing = internalFind(new_item.first);
+        if (existing != NULL) {
+            return std::make_pair(existing, false);
+        }
+    }
+    if (this->root_ == NULL) {
+        return AVLTree<Key, Value>::internalInsert(new_item, overwrite);
+    }
+
+    AVLNode<Key, Value>* rightmost = static_cast<AVLNode<Key, Value>*>(this->rightmost_);
+    if (!(new_item.first < rightmost->getKey())) {
+        return std::make_pair(this->attachNode(rightmost, true, new_item), true);
+    }
+
+    AVLNode<Key, Value>* parent = NULL;
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->root_);
+    bool right = false;
+    while (node != NULL) {
+        parent = node;
+        right = !(new_item.first < node->getKey());
+        node = right ? node->getRight() : node->getLeft();
+    }
+    return std::make_pair(this->attachNode(parent, right, new_item), true);
+}
+
+/**
+* Inserts new_item just before hint, without a search from the root, when
+* its key fits there and is less than hint's; otherwise inserts it as
+* insert does. Either way it lands after any items with an equal key, so
+* equal keys keep their insertion order. Never replaces a value.
+*/
+template<class Key, class Value>
+typename AVLMultiTree<Key, Value>::iterator
+AVLMultiTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &new_item)
+{
+    AVLNode<Key, Value>* h = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(hint));
+    const Key& key = new_item.first;
+
+    if (h != NULL && key < h->getKey()) {
+        AVLNode<Key, Value>* pred = static_cast<AVLNode<Key, Value>*>(this->predecessor(h));
+        if (pred == NULL || !(key < pred->getKey())) {
+            if (h->getLeft() == NULL) {
+                return this->makeIterator(this->attachNode(h, false, new_item));
+            }
+            return this->makeIterator(this->attachNode(pred, true, new_item)); // pred is the max of h's left subtree
+        }
+    }
+    return this->makeIterator(internalInsert(new_item, true).first);
+}
+
+/**
+* Removes every occurrence of key and returns how many there were.
+*/
+template<class Key, class Value>
+size_t AVLMultiTree<Key, Value>::removeAll(const Key& key)
+{
+    size_t removed = 0;
+    Node<Key, Value>* node = internalFind(key);
+    while (node != NULL && !(key < node->getKey())) {
+        Node<Key, Value>* next = this->successor(node);
+        this->removeNode(node);
+        node = next;
+        ++removed;
+    }
+    return removed;
+}
+
+/**
+* Removes every occurrence of key.
+*/
+template<class Key, class Value>
+void AVLMultiTree<Key, Value>::remove(const Key& key)
+{
+    removeAll(key);
+}
+
+/**
+* Removes every occurrence of each key in keys and returns how many items
+* went. AVLTree's single-pass version assumes at most one node per key, so
+* each distinct key is removed on its own here.
+*/
+template<class Key, class Value>
+size_t AVLMultiTree<Key, Value>::remove_batch(const std::vector<Key>& keys)
+{
+    std::vector<Key> sorted(keys);
+    std::sort(sorted.begin(), sorted.end());
+    size_t removed = 0;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i == 0 || sorted[i - 1] < sorted[i]) {
+            removed += removeAll(sorted[i]);
+        }
+    }
+    return removed;
+}
+
+/**
+* Inserts every item of other after any occurrences of its key already
+* here and returns how many items were added, which is all of them.
+* Equal keys are kept side by side rather than resolved into one item.
+* O(m log(n + m)).
+*/
+template<class Key, class Value>
+size_t AVLMultiTree<Key, Value>::mergeWith(const AVLTree<Key, Value>& other,
+                                           const typename AVLTree<Key, Value>::Resolver& resolve)
+{
+    if (this == &other) {
+        AVLTree<Key, Value> snapshot(other);
+        return mergeWith(snapshot, resolve);
+    }
+    size_t added = 0;
+    for (iterator it = other.begin(); it != other.end(); ++it) {
+        internalInsert(*it, true);
+        ++added;
+    }
+    return added;
+}
+
+template<class Key, class Value>
+typename AVLMultiTree<Key, Value>::iterator AVLMultiTree<Key, Value>::lower_bound(const Key& key) const
+{
+    return this->makeIterator(lowerBoundNode(key));
+}
+
+template<class Key, class Value>
+typename AVLMultiTree<Key, Value>::iterator AVLMultiTree<Key, Value>::upper_bound(const Key& key) const
+{
+    return this->makeIterator(upperBoundNode(key));
+}
+
+/**
+* Returns the occurrences of key as [first, second), in insertion order.
+* One descent down to the first equal node, then the lower bound is looked
+* for in its left subtree and the upper bound in its right.
+*/
+template<class Key, class Value>
+std::pair<typename AVLMultiTree<Key, Value>::iterator, typename AVLMultiTree<Key, Value>::iterator>
+AVLMultiTree<Key, Value>::equal_range(const Key& key) const
+{
+    Node<Key, Value>* upper = NULL;
+    Node<Key, Value>* node = this->root_;
+    while (node != NULL) {
+        if (node->getKey() < key) {
+            node = node->getRight();
+        }
+        else if (key < node->getKey()) {
+            upper = node;
+            node = node->getLeft();
+        }
+        else {
+            Node<Key, Value>* lower = node;
+            for (Node<Key, Value>* n = node->getLeft(); n != NULL; ) {
+                if (n->getKey() < key) {
+                    n = n->getRight();
+                }
+                else {
+                    lower = n;
+                    n = n->getLeft();
+                }
+            }
+            for (Node<Key, Value>* n = node->getRight(); n != NULL; ) {
+                if (key < n->getKey()) {
+                    upper = n;
+                    n = n->getLeft();
+                }
+                else {
+                    n = n->getRight();
+                }
+            }
+            return std::make_pair(this->makeIterator(lower), this->makeIterator(upper));
+        }
+    }
+    return std::make_pair(this->makeIterator(upper), this->makeIterator(upper));
+}
+
+/**
+* Returns the number of occurrences of key, in O(log n + count).
+*/
+template<class Key, class Value>
+size_t AVLMultiTree<Key, Value>::count(const Key& key) const
+{
+    size_t n = 0;
+    for (Node<Key, Value>* node = internalFind(key); node != NULL && !(key < node->getKey());
+         node = this->successor(node)) {
+        ++n;
+    }
+    return n;
+}
+
+/*
+  -------------------------------------------
+  End implementations for the AVLMultiTree class.
+  -------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,574 @@
+#ifndef POOLEDAVL_H
+#define POOLEDAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "indexavl.h"
+
+/**
+* An AVL tree whose nodes live in a single growable vector and refer to each
+* other by 32-bit indices instead of pointers. Because no link is an address,
+* the whole tree can be copied (or, for trivially copyable keys and values,
+* memcpy'd / written to disk) without any fix-up, and the links take half the
+* space of Node's parent_/left_/right_ pointers.
+*
+* Freed slots are threaded onto a free list and reused by later insertions, so
+* the pool never holds more than the peak number of live entries. Iterators
+* stay valid across insertions (they hold an index, not an address) but an
+* iterator to a removed entry is invalidated as usual. The balancing
+* itself is IndexedAVL's, shared with SharedAVLTree.
+*/
+template <typename Key, typename Value>
+class PooledAVLTree : public IndexedAVL<PooledAVLTree<Key, Value>, Key>
+{
+public:
+    typedef typename IndexedAVL<PooledAVLTree<Key, Value>, Key>::index_type index_type;
+    using IndexedAVL<PooledAVLTree<Key, Value>, Key>::NIL;
+
+    class iterator;
+
+    PooledAVLTree();
+    PooledAVLTree(const PooledAVLTree& other);
+    PooledAVLTree(PooledAVLTree&& other);
+    PooledAVLTree& operator=(const PooledAVLTree& other);
+    PooledAVLTree& operator=(PooledAVLTree&& other);
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    iterator erase(iterator pos);
+    std::pair<iterator, bool> find_or_insert(const std::pair<const Key, Value>& keyValuePair);
+    void clear();
+    void reserve(size_t n);
+    bool empty() const;
+    size_t size() const;
+
+    /**
+    * An iterator over the pool, visiting entries in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class PooledAVLTree<Key, Value>;
+        iterator(PooledAVLTree<Key, Value>* tree, index_type idx);
+        PooledAVLTree<Key, Value>* tree_;
+        index_type current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    /**
+    * A pool slot. Its item only exists while the slot is in the tree:
+    * freeNode destroys it, so a slot on the free list does not keep a large
+    * key or value alive, and allocNode constructs the next one in place.
+    * live records which is the case, for the vector's copies and
+    * destruction.
+    */
+    struct PoolNode
+    {
+        typedef std::pair<const Key, Value> Item;
+
+        PoolNode(const Key& key, const Value& value, index_type parent);
+        PoolNode(const PoolNode& other);
+        ~PoolNode();
+        PoolNode& operator=(const PoolNode& other) = delete;
+
+        Item& item();
+        const Item& item() const;
+        void construct(const Key& key, const Value& value);
+        void destroy();
+
+        typename std::aligned_storage<sizeof(Item), alignof(Item)>::type storage;
+        index_type parent;
+        index_type left;
+        index_type right;
+        int8_t balance;
+        bool live;
+    };
+
+    friend class IndexedAVL<PooledAVLTree<Key, Value>, Key>;
+
+    PoolNode& slot(index_type idx);
+    const PoolNode& slot(index_type idx) const;
+    const Key& slotKey(index_type idx) const;
+    index_type& rootIndex();
+    index_type rootIndex() const;
+    std::pair<index_type, bool> internalInsert(const std::pair<const Key, Value>& keyValuePair,
+                                               bool overwrite);
+    index_type allocNode(const Key& key, const Value& value, index_type parent);
+    void freeNode(index_type idx);
+
+    std::vector<PoolNode> nodes_;
+    index_type root_;
+    index_type freeList_;
+    size_t size_;
+};
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the PooledAVLTree::iterator
+  ----------------------------------------------------
+*/
+
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::iterator::iterator() :
+    tree_(NULL), current_(NIL)
+{
+
+}
+
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::iterator::iterator(PooledAVLTree<Key, Value>* tree, index_type idx) :
+    tree_(tree), current_(idx)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value>&
+PooledAVLTree<Key, Value>::iterator::operator*() const
+{
+    return tree_->nodes_[current_].item();
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value>*
+PooledAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(tree_->nodes_[current_].item());
+}
+
+template<class Key, class Value>
+bool PooledAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool PooledAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances the iterator's location using an in-order sequencing
+*/
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::iterator&
+PooledAVLTree<Key, Value>::iterator::operator++()
+{
+    current_ = tree_->successor(current_);
+    return *this;
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the PooledAVLTree::iterator
+  --------------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the PooledAVLTree class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::PoolNode::PoolNode(const Key& key, const Value& value, index_type parent) :
+    parent(parent), left(NIL), right(NIL), balance(0), live(false)
+{
+    construct(key, value);
+}
+
+/**
+* Copies the links, and the item if the slot holds one. If that copy
+* throws, nothing was constructed.
+*/
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::PoolNode::PoolNode(const PoolNode& other) :
+    parent(other.parent), left(other.left), right(other.right), balance(other.balance), live(false)
+{
+    if (other.live) {
+        construct(other.item().first, other.item().second);
+    }
+}
+
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::PoolNode::~PoolNode()
+{
+    destroy();
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::PoolNode::Item&
+PooledAVLTree<Key, Value>::PoolNode::item()
+{
+    return *reinterpret_cast<Item*>(&storage);
+}
+
+template<class Key, class Value>
+const typename PooledAVLTree<Key, Value>::PoolNode::Item&
+PooledAVLTree<Key, Value>::PoolNode::item() const
+{
+    return *reinterpret_cast<const Item*>(&storage);
+}
+
+/**
+* Constructs the item in an empty slot. The slot is only marked live once
+* the key and value copies have succeeded.
+*/
+template<class Key, class Value>
+void PooledAVLTree<Key, Value>::PoolNode::construct(const Key& key, const Value& value)
+{
+    new (&storage) Item(key, value);
+    live = true;
+}
+
+template<class Key, class Value>
+void PooledAVLTree<Key, Value>::PoolNode::destroy()
+{
+    if (live) {
+        item().~Item();
+        live = false;
+    }
+}
+
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::PooledAVLTree() :
+    root_(NIL), freeList_(NIL), size_(0)
+{
+
+}
+
+/**
+* Copies the pool slot for slot, free list included, so every index (and
+* so every link) means the same in the copy.
+*/
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::PooledAVLTree(const PooledAVLTree& other) :
+    nodes_(other.nodes_), root_(other.root_), freeList_(other.freeList_), size_(other.size_)
+{
+
+}
+
+/**
+* Takes over other's pool in O(1), leaving other empty.
+*/
+template<class Key, class Value>
+PooledAVLTree<Key, Value>::PooledAVLTree(PooledAVLTree&& other) :
+    nodes_(std::move(other.nodes_)), root_(other.root_), freeList_(other.freeList_), size_(other.size_)
+{
+    other.clear();
+}
+
+/**
+* Copies into a temporary and swaps it in, so this tree is unchanged if a
+* copy throws.
+*/
+template<class Key, class Value>
+PooledAVLTree<Key, Value>& PooledAVLTree<Key, Value>::operator=(const PooledAVLTree& other)
+{
+    if (this != &other) {
+        PooledAVLTree<Key, Value> copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template<class Key, class Value>
+PooledAVLTree<Key, Value>& PooledAVLTree<Key, Value>::operator=(PooledAVLTree&& other)
+{
+    if (this != &other) {
+        nodes_.swap(other.nodes_);
+        std::swap(root_, other.root_);
+        std::swap(freeList_, other.freeList_);
+        std::swap(size_, other.size_);
+        other.clear();
+    }
+    return *this;
+}
+
+template<class Key, class Value>
+bool PooledAVLTree<Key, Value>::empty() const
+{
+    return root_ == NIL;
+}
+
+template<class Key, class Value>
+size_t PooledAVLTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+/**
+* Pre-sizes the pool so that the first n insertions do not reallocate.
+*/
+template<class Key, class Value>
+void PooledAVLTree<Key, Value>::reserve(size_t n)
+{
+    nodes_.reserve(n);
+}
+
+/**
+* Releases every slot. The pool's capacity is kept for reuse.
+*/
+template<class Key, class Value>
+void PooledAVLTree<Key, Value>::clear()
+{
+    nodes_.clear();
+    root_ = NIL;
+    freeList_ = NIL;
+    size_ = 0;
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::iterator
+PooledAVLTree<Key, Value>::begin() const
+{
+    return iterator(const_cast<PooledAVLTree<Key, Value>*>(this), this->getSmallestNode());
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::iterator
+PooledAVLTree<Key, Value>::end() const
+{
+    return iterator(const_cast<PooledAVLTree<Key, Value>*>(this), NIL);
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::iterator
+PooledAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(const_cast<PooledAVLTree<Key, Value>*>(this), this->internalFind(key));
+}
+
+/**
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent.
+ */
+template<class Key, class Value>
+Value& PooledAVLTree<Key, Value>::operator[](const Key& key)
+{
+    return nodes_[internalInsert(std::make_pair(key, Value()), false).first].item().second;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value const & PooledAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    index_type curr = this->internalFind(key);
+    if(curr == NIL) throw std::out_of_range("Invalid key");
+    return nodes_[curr].item().second;
+}
+
+/**
+* Takes a slot off the free list (or grows the pool) and constructs a node
+* in it. A reused slot only leaves the free list once its item has been
+* constructed, so a throwing key or value copy leaves the pool as it was.
+*/
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::index_type
+PooledAVLTree<Key, Value>::allocNode(const Key& key, const Value& value, index_type parent)
+{
+    index_type idx;
+    if (freeList_ != NIL) {
+        idx = freeList_;
+        PoolNode& slot = nodes_[idx];
+        slot.construct(key, value);
+        freeList_ = slot.left;
+        slot.parent = parent;
+        slot.left = NIL;
+        slot.right = NIL;
+        slot.balance = 0;
+    }
+    else {
+        if (nodes_.size() >= NIL) {
+            throw std::length_error("PooledAVLTree is full");
+        }
+        idx = static_cast<index_type>(nodes_.size());
+        nodes_.emplace_back(key, value, parent);
+    }
+    ++size_;
+    return idx;
+}
+
+/**
+* Destroys a slot's item and puts the slot back on the free list, chained
+* through its left link.
+*/
+template<class Key, class Value>
+void PooledAVLTree<Key, Value>::freeNode(index_type idx)
+{
+    nodes_[idx].destroy();
+    nodes_[idx].parent = NIL;
+    nodes_[idx].right = NIL;
+    nodes_[idx].left = freeList_;
+    freeList_ = idx;
+    --size_;
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::PoolNode&
+PooledAVLTree<Key, Value>::slot(index_type idx)
+{
+    return nodes_[idx];
+}
+
+template<class Key, class Value>
+const typename PooledAVLTree<Key, Value>::PoolNode&
+PooledAVLTree<Key, Value>::slot(index_type idx) const
+{
+    return nodes_[idx];
+}
+
+template<class Key, class Value>
+const Key& PooledAVLTree<Key, Value>::slotKey(index_type idx) const
+{
+    return nodes_[idx].item().first;
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::index_type&
+PooledAVLTree<Key, Value>::rootIndex()
+{
+    return root_;
+}
+
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::index_type
+PooledAVLTree<Key, Value>::rootIndex() const
+{
+    return root_;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Returns an iterator to the item and whether a new slot was used.
+ */
+template<class Key, class Value>
+std::pair<typename PooledAVLTree<Key, Value>::iterator, bool>
+PooledAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::pair<index_type, bool> result = internalInsert(keyValuePair, true);
+    return std::make_pair(iterator(this, result.first), result.second);
+}
+
+/**
+* Inserts keyValuePair only if its key is absent. Returns an iterator to the
+* key's item and whether it was inserted.
+*/
+template<class Key, class Value>
+std::pair<typename PooledAVLTree<Key, Value>::iterator, bool>
+PooledAVLTree<Key, Value>::find_or_insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::pair<index_type, bool> result = internalInsert(keyValuePair, false);
+    return std::make_pair(iterator(this, result.first), result.second);
+}
+
+/**
+* Descends once, attaching a new slot or stopping at the existing one (whose
+* value is replaced only if overwrite is set). Returns the slot and whether
+* it is new.
+*/
+template<class Key, class Value>
+std::pair<typename PooledAVLTree<Key, Value>::index_type, bool>
+PooledAVLTree<Key, Value>::internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite)
+{
+    const Key& key = keyValuePair.first;
+    if (root_ == NIL) {
+        root_ = allocNode(key, keyValuePair.second, NIL);
+        return std::make_pair(root_, true);
+    }
+
+    index_type active = root_;
+    index_type child;
+    while (true) {
+        if (key < nodes_[active].item().first) {
+            if (nodes_[active].left == NIL) {
+                child = allocNode(key, keyValuePair.second, active);
+                nodes_[active].left = child;
+                break;
+            }
+            active = nodes_[active].left;
+        }
+        else if (nodes_[active].item().first < key) {
+            if (nodes_[active].right == NIL) {
+                child = allocNode(key, keyValuePair.second, active);
+                nodes_[active].right = child;
+                break;
+            }
+            active = nodes_[active].right;
+        }
+        else {
+            if (overwrite) {
+                nodes_[active].item().second = keyValuePair.second;
+            }
+            return std::make_pair(active, false);
+        }
+    }
+
+    this->attachFix(child);
+    return std::make_pair(child, true);
+}
+
+/*
+ * If a node has 2 children it is swapped with its predecessor
+ * before being unlinked.
+ */
+template<class Key, class Value>
+void PooledAVLTree<Key, Value>::remove(const Key& key)
+{
+    this->removeNode(this->internalFind(key));
+}
+
+/**
+* Removes the item pos refers to without searching for its key again.
+* Returns an iterator to the item that followed it.
+*/
+template<class Key, class Value>
+typename PooledAVLTree<Key, Value>::iterator
+PooledAVLTree<Key, Value>::erase(iterator pos)
+{
+    index_type next = this->successor(pos.current_);
+    this->removeNode(pos.current_);
+    return iterator(this, next);
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the PooledAVLTree class.
+  ---------------------------------------------
+*/
+
+#endif
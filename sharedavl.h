@@ -0,0 +1,767 @@
+#ifndef SHAREDAVL_H
+#define SHAREDAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "indexavl.h"
+
+/**
+* An AVL tree in a POSIX shared-memory segment, built once by a writer
+* process and read in place by any number of reader processes, so that
+* workers on one machine share a single copy instead of each building its
+* own.
+*
+* The segment is a header followed by a fixed number of node slots. Nodes
+* link to each other by 32-bit slot indices, as in PooledAVLTree, so the
+* tree means the same wherever each process maps the segment, and the
+* writer balances them with the same IndexedAVL code. Keys and
+* values are stored in the slots as they are and must be trivially
+* copyable: no pointers into one process's heap.
+*
+* One process writes, through the object that created the segment; several
+* writers need a lock of their own around it. Every change is bracketed by
+* a sequence lock: the sequence number in the header is odd while a change
+* is under way. Readers take no lock. A lookup or iterator step reads the
+* sequence number, works on the shared slots, and starts over if the number
+* was odd or has changed by the end. Since a reader may see a change half
+* done, every index it follows is checked against the slot count and every
+* walk is bounded, so a torn read only costs a retry. Iterators hold a
+* copy of their item, not a reference into the segment.
+*
+* If the writer dies during a change the sequence number stays odd and
+* readers wait for good; the segment has to be built again.
+*/
+template <typename Key, typename Value>
+class SharedAVLTree : public IndexedAVL<SharedAVLTree<Key, Value>, Key>
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "SharedAVLTree keys and values must be trivially copyable");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+                  "SharedAVLTree needs lock-free 64-bit atomics to share them between processes");
+
+public:
+    typedef typename IndexedAVL<SharedAVLTree<Key, Value>, Key>::index_type index_type;
+    using IndexedAVL<SharedAVLTree<Key, Value>, Key>::NIL;
+
+    class iterator;
+
+    SharedAVLTree(const char* name, size_t capacity);
+    explicit SharedAVLTree(const char* name);
+    ~SharedAVLTree();
+    SharedAVLTree(const SharedAVLTree&) = delete;
+    SharedAVLTree& operator=(const SharedAVLTree&) = delete;
+    static void unlink(const char* name);
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    size_t capacity() const;
+    bool writable() const;
+
+    /**
+    * An iterator visiting the items in key order. It keeps a copy of the
+    * current item, read consistently, so dereferencing never touches the
+    * segment. Stepping resumes from the current slot if nothing was written
+    * since, and otherwise searches for the next larger key, so a walk stays
+    * in key order while the writer works.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<Key, Value>& operator*() const;
+        const std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class SharedAVLTree<Key, Value>;
+        iterator(const SharedAVLTree<Key, Value>* tree);
+        const SharedAVLTree<Key, Value>* tree_;
+        index_type current_;
+        uint64_t sequence_;  // the sequence number the copy was read under
+        std::pair<Key, Value> item_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+
+protected:
+    struct SharedNode
+    {
+        Key key;
+        Value value;
+        index_type parent;
+        index_type left;
+        index_type right;
+        int8_t balance;
+    };
+
+    struct Header
+    {
+        std::atomic<uint64_t> magic;     // set last, once the segment is ready
+        std::atomic<uint64_t> sequence;  // odd while the writer is changing the tree
+        uint64_t capacity;
+        uint64_t size;
+        index_type root;
+        index_type freeList;
+        index_type used;                 // slots ever handed out
+    };
+
+    // Identifies the layout; the slot size catches readers built with
+    // other key or value types.
+    static const uint64_t MAGIC = 0x5348415641564C00ull;
+    // No consistent walk is longer: an AVL tree of 2^32 nodes is at most
+    // 46 levels high.
+    static const int MAX_STEPS = 128;
+
+    static size_t segmentBytes(size_t capacity);
+    static uint64_t layoutMagic();
+    void map(int fd, size_t bytes, bool writable);
+
+    template <typename Read>
+    uint64_t readConsistent(Read read) const;
+    void beginWrite();
+    void endWrite();
+    void requireWritable() const;
+
+    bool readFind(const Key& key, iterator& it) const;
+    bool readFirst(iterator& it) const;
+    bool readNext(iterator& it, bool resume) const;
+    bool readSlot(index_type idx, iterator& it) const;
+    bool valid(index_type idx) const;
+
+    friend class IndexedAVL<SharedAVLTree<Key, Value>, Key>;
+
+    SharedNode& slot(index_type idx);
+    const SharedNode& slot(index_type idx) const;
+    const Key& slotKey(index_type idx) const;
+    index_type& rootIndex();
+    index_type rootIndex() const;
+    index_type allocNode(const Key& key, const Value& value, index_type parent);
+    void freeNode(index_type idx);
+
+    void* mapping_;
+    size_t bytes_;
+    bool writable_;
+    Header* header_;
+    SharedNode* nodes_;
+};
+
+template<class Key, class Value>
+const uint64_t SharedAVLTree<Key, Value>::MAGIC;
+
+template<class Key, class Value>
+const int SharedAVLTree<Key, Value>::MAX_STEPS;
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the SharedAVLTree::iterator
+  ----------------------------------------------------
+*/
+
+template<class Key, class Value>
+SharedAVLTree<Key, Value>::iterator::iterator() :
+    tree_(NULL), current_(NIL), sequence_(0), item_()
+{
+
+}
+
+template<class Key, class Value>
+SharedAVLTree<Key, Value>::iterator::iterator(const SharedAVLTree<Key, Value>* tree) :
+    tree_(tree), current_(NIL), sequence_(0), item_()
+{
+
+}
+
+/**
+* Provides access to the copy of the item.
+*/
+template<class Key, class Value>
+const std::pair<Key, Value>&
+SharedAVLTree<Key, Value>::iterator::operator*() const
+{
+    return item_;
+}
+
+template<class Key, class Value>
+const std::pair<Key, Value>*
+SharedAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &item_;
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Moves to the next larger key. Resuming from the current slot is only
+* safe when nothing was written since it was read; otherwise the slot may
+* have moved or been reused, and the next key is searched for from the
+* root.
+*/
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::iterator&
+SharedAVLTree<Key, Value>::iterator::operator++()
+{
+    const SharedAVLTree<Key, Value>* tree = tree_;
+    iterator& self = *this;
+    iterator next(tree);
+    uint64_t seen = sequence_;
+    next.sequence_ = tree->readConsistent([&](uint64_t sequence) {
+        next.item_ = self.item_;
+        next.current_ = self.current_;
+        return tree->readNext(next, sequence == seen);
+    });
+    *this = next;
+    return *this;
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the SharedAVLTree::iterator
+  --------------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the SharedAVLTree class.
+  -----------------------------------------------
+*/
+
+/**
+* Creates the segment name (which must not exist yet) with room for
+* capacity items and maps it for writing. Throws std::system_error if the
+* segment cannot be created.
+*/
+template<class Key, class Value>
+SharedAVLTree<Key, Value>::SharedAVLTree(const char* name, size_t capacity) :
+    mapping_(NULL), bytes_(0), writable_(true), header_(NULL), nodes_(NULL)
+{
+    if (capacity >= NIL) {
+        throw std::length_error("SharedAVLTree capacity is too large");
+    }
+    int fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    size_t bytes = segmentBytes(capacity);
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        int error = errno;
+        ::close(fd);
+        ::shm_unlink(name);
+        throw std::system_error(error, std::generic_category(), "ftruncate");
+    }
+    try {
+        map(fd, bytes, true);
+    }
+    catch (...) {
+        ::shm_unlink(name);
+        throw;
+    }
+    header_->sequence.store(0, std::memory_order_relaxed);
+    header_->capacity = capacity;
+    header_->size = 0;
+    header_->root = NIL;
+    header_->freeList = NIL;
+    header_->used = 0;
+    header_->magic.store(layoutMagic(), std::memory_order_release);
+}
+
+/**
+* Maps an existing segment read-only. Throws std::system_error if it
+* cannot be opened and std::runtime_error if it does not hold a tree of
+* this type (or is not ready yet).
+*/
+template<class Key, class Value>
+SharedAVLTree<Key, Value>::SharedAVLTree(const char* name) :
+    mapping_(NULL), bytes_(0), writable_(false), header_(NULL), nodes_(NULL)
+{
+    int fd = ::shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat");
+    }
+    if (static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error("SharedAVLTree segment is not ready");
+    }
+    map(fd, static_cast<size_t>(st.st_size), false);
+    if (header_->magic.load(std::memory_order_acquire) != layoutMagic() ||
+        segmentBytes(header_->capacity) > bytes_) {
+        ::munmap(mapping_, bytes_);
+        throw std::runtime_error("SharedAVLTree segment has another layout or is not ready");
+    }
+}
+
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::map(int fd, size_t bytes, bool writable)
+{
+    void* mapping = ::mmap(NULL, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+    mapping_ = mapping;
+    bytes_ = bytes;
+    header_ = static_cast<Header*>(mapping);
+    nodes_ = reinterpret_cast<SharedNode*>(static_cast<char*>(mapping) + segmentBytes(0));
+}
+
+/**
+* Unmaps the segment. It stays in place for other processes until unlink
+* is called.
+*/
+template<class Key, class Value>
+SharedAVLTree<Key, Value>::~SharedAVLTree()
+{
+    ::munmap(mapping_, bytes_);
+}
+
+/**
+* Removes the segment's name. Processes that have it mapped keep using it.
+*/
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::unlink(const char* name)
+{
+    ::shm_unlink(name);
+}
+
+template<class Key, class Value>
+size_t SharedAVLTree<Key, Value>::segmentBytes(size_t capacity)
+{
+    size_t header = (sizeof(Header) + alignof(SharedNode) - 1) / alignof(SharedNode) * alignof(SharedNode);
+    return header + capacity * sizeof(SharedNode);
+}
+
+template<class Key, class Value>
+uint64_t SharedAVLTree<Key, Value>::layoutMagic()
+{
+    return MAGIC ^ sizeof(SharedNode);
+}
+
+/**
+* Runs read(sequence) until it completes under one even sequence number
+* that is still current afterwards, and returns that number. read returns
+* false when it meets links that cannot be right, which only a concurrent
+* write explains. While a write is under way the reader yields its time
+* slice rather than spin, since the writer may be waiting for the CPU.
+*/
+template<class Key, class Value>
+template <typename Read>
+uint64_t SharedAVLTree<Key, Value>::readConsistent(Read read) const
+{
+    while (true) {
+        uint64_t sequence = header_->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        bool ok = read(sequence);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ok && header_->sequence.load(std::memory_order_relaxed) == sequence) {
+            return sequence;
+        }
+    }
+}
+
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::beginWrite()
+{
+    requireWritable();
+    header_->sequence.store(header_->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::endWrite()
+{
+    header_->sequence.store(header_->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::requireWritable() const
+{
+    if (!writable_) {
+        throw std::logic_error("SharedAVLTree is mapped read-only");
+    }
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::writable() const
+{
+    return writable_;
+}
+
+template<class Key, class Value>
+size_t SharedAVLTree<Key, Value>::capacity() const
+{
+    return header_->capacity;
+}
+
+template<class Key, class Value>
+size_t SharedAVLTree<Key, Value>::size() const
+{
+    size_t size = 0;
+    readConsistent([&](uint64_t) {
+        size = header_->size;
+        return true;
+    });
+    return size;
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::empty() const
+{
+    return size() == 0;
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::valid(index_type idx) const
+{
+    return idx < header_->capacity;
+}
+
+/**
+* Copies slot idx into it, unless idx cannot be a slot.
+*/
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::readSlot(index_type idx, iterator& it) const
+{
+    if (!valid(idx)) {
+        return false;
+    }
+    it.current_ = idx;
+    it.item_.first = nodes_[idx].key;
+    it.item_.second = nodes_[idx].value;
+    return true;
+}
+
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::iterator
+SharedAVLTree<Key, Value>::begin() const
+{
+    iterator it(this);
+    it.sequence_ = readConsistent([&](uint64_t) {
+        return readFirst(it);
+    });
+    return it;
+}
+
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::iterator
+SharedAVLTree<Key, Value>::end() const
+{
+    return iterator(this);
+}
+
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::iterator
+SharedAVLTree<Key, Value>::find(const Key& key) const
+{
+    iterator it(this);
+    it.sequence_ = readConsistent([&](uint64_t) {
+        return readFind(key, it);
+    });
+    return it;
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::readFind(const Key& key, iterator& it) const
+{
+    it.current_ = NIL;
+    index_type active = header_->root;
+    for (int steps = 0; active != NIL; ++steps) {
+        if (!valid(active) || steps == MAX_STEPS) {
+            return false;
+        }
+        const SharedNode& node = nodes_[active];
+        if (key < node.key) {
+            active = node.left;
+        }
+        else if (node.key < key) {
+            active = node.right;
+        }
+        else {
+            return readSlot(active, it);
+        }
+    }
+    return true;
+}
+
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::readFirst(iterator& it) const
+{
+    it.current_ = NIL;
+    index_type active = header_->root;
+    if (active == NIL) {
+        return true;
+    }
+    for (int steps = 0; ; ++steps) {
+        if (!valid(active) || steps == MAX_STEPS) {
+            return false;
+        }
+        if (nodes_[active].left == NIL) {
+            return readSlot(active, it);
+        }
+        active = nodes_[active].left;
+    }
+}
+
+/**
+* Moves it to the item after it.item_'s key: along the links from its
+* slot if resume is set, otherwise by a search from the root for the
+* smallest larger key.
+*/
+template<class Key, class Value>
+bool SharedAVLTree<Key, Value>::readNext(iterator& it, bool resume) const
+{
+    if (!resume) {
+        index_type next = NIL;
+        index_type active = header_->root;
+        for (int steps = 0; active != NIL; ++steps) {
+            if (!valid(active) || steps == MAX_STEPS) {
+                return false;
+            }
+            if (it.item_.first < nodes_[active].key) {
+                next = active;
+                active = nodes_[active].left;
+            }
+            else {
+                active = nodes_[active].right;
+            }
+        }
+        it.current_ = NIL;
+        return next == NIL || readSlot(next, it);
+    }
+
+    index_type current = it.current_;
+    it.current_ = NIL;
+    if (!valid(current)) {
+        return false;
+    }
+    index_type active = nodes_[current].right;
+    if (active != NIL) {
+        for (int steps = 0; ; ++steps) {
+            if (!valid(active) || steps == MAX_STEPS) {
+                return false;
+            }
+            if (nodes_[active].left == NIL) {
+                return readSlot(active, it);
+            }
+            active = nodes_[active].left;
+        }
+    }
+    index_type child = current;
+    index_type parent = nodes_[current].parent;
+    for (int steps = 0; parent != NIL; ++steps) {
+        if (!valid(parent) || steps == MAX_STEPS) {
+            return false;
+        }
+        if (nodes_[parent].right != child) {
+            return readSlot(parent, it);
+        }
+        child = parent;
+        parent = nodes_[parent].parent;
+    }
+    return true;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Throws std::length_error when every slot is in use.
+ */
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    requireWritable();
+    const Key& key = keyValuePair.first;
+    index_type active = header_->root;
+    index_type parent = NIL;
+    bool right = false;
+    while (active != NIL) {
+        if (key < nodes_[active].key) {
+            right = false;
+        }
+        else if (nodes_[active].key < key) {
+            right = true;
+        }
+        else {
+            beginWrite();
+            nodes_[active].value = keyValuePair.second;
+            endWrite();
+            return;
+        }
+        parent = active;
+        active = right ? nodes_[active].right : nodes_[active].left;
+    }
+    if (header_->freeList == NIL && header_->used == header_->capacity) {
+        throw std::length_error("SharedAVLTree is full");
+    }
+
+    beginWrite();
+    index_type child = allocNode(key, keyValuePair.second, parent);
+    if (parent == NIL) {
+        header_->root = child;
+    }
+    else if (right) {
+        nodes_[parent].right = child;
+    }
+    else {
+        nodes_[parent].left = child;
+    }
+    this->attachFix(child);
+    endWrite();
+}
+
+/*
+ * If a node has 2 children it is swapped with its predecessor
+ * before being unlinked.
+ */
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::remove(const Key& key)
+{
+    requireWritable();
+    index_type found = this->internalFind(key);
+    if (found == NIL) {
+        return;
+    }
+    beginWrite();
+    this->removeNode(found);
+    endWrite();
+}
+
+/**
+* Releases every slot.
+*/
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::clear()
+{
+    beginWrite();
+    header_->root = NIL;
+    header_->freeList = NIL;
+    header_->used = 0;
+    header_->size = 0;
+    endWrite();
+}
+
+/**
+* Takes a slot off the free list, or the next never-used one.
+*/
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::index_type
+SharedAVLTree<Key, Value>::allocNode(const Key& key, const Value& value, index_type parent)
+{
+    index_type idx;
+    if (header_->freeList != NIL) {
+        idx = header_->freeList;
+        header_->freeList = nodes_[idx].left;
+    }
+    else {
+        idx = header_->used++;
+    }
+    SharedNode& node = nodes_[idx];
+    node.key = key;
+    node.value = value;
+    node.parent = parent;
+    node.left = NIL;
+    node.right = NIL;
+    node.balance = 0;
+    ++header_->size;
+    return idx;
+}
+
+/**
+* Puts a slot back on the free list, chained through its left link.
+*/
+template<class Key, class Value>
+void SharedAVLTree<Key, Value>::freeNode(index_type idx)
+{
+    nodes_[idx].parent = NIL;
+    nodes_[idx].right = NIL;
+    nodes_[idx].left = header_->freeList;
+    header_->freeList = idx;
+    --header_->size;
+}
+
+/**
+* The writer's accessors for IndexedAVL. They read the segment without
+* sequence checks, which only the writer may do.
+*/
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::SharedNode&
+SharedAVLTree<Key, Value>::slot(index_type idx)
+{
+    return nodes_[idx];
+}
+
+template<class Key, class Value>
+const typename SharedAVLTree<Key, Value>::SharedNode&
+SharedAVLTree<Key, Value>::slot(index_type idx) const
+{
+    return nodes_[idx];
+}
+
+template<class Key, class Value>
+const Key& SharedAVLTree<Key, Value>::slotKey(index_type idx) const
+{
+    return nodes_[idx].key;
+}
+
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::index_type&
+SharedAVLTree<Key, Value>::rootIndex()
+{
+    return header_->root;
+}
+
+template<class Key, class Value>
+typename SharedAVLTree<Key, Value>::index_type
+SharedAVLTree<Key, Value>::rootIndex() const
+{
+    return header_->root;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the SharedAVLTree class.
+  ---------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef SLABAVL_H
+#define SLABAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "pooledavl.h"
+
+/**
+* An AVL map that keeps values out of the search structure. The tree itself
+* is a PooledAVLTree from each key to a 32-bit slot in a separate value slab,
+* so a lookup only touches keys and links; the value is read when the caller
+* dereferences the iterator. This pays off when values are much larger than
+* keys, since each search step then touches a cache line holding only key
+* and link data.
+*
+* Dereferencing an iterator yields a pair of references (key, value) rather
+* than a reference to a stored pair; it->first and it->second work as usual.
+*/
+template <typename Key, typename Value>
+class SlabAVLTree
+{
+public:
+    typedef typename PooledAVLTree<Key, uint32_t>::index_type slot_type;
+
+    class iterator;
+
+    SlabAVLTree();
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair);
+    std::pair<iterator, bool> find_or_insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    void reserve(size_t n);
+    bool empty() const;
+    size_t size() const;
+
+    /**
+    * An iterator walking the key tree in order and resolving values
+    * from the slab on demand.
+    */
+    class iterator
+    {
+    public:
+        typedef std::pair<const Key&, Value&> reference;
+
+        /**
+        * Holds the reference pair so that operator-> has something to point at.
+        */
+        struct pointer
+        {
+            reference ref;
+            const reference* operator->() const { return &ref; }
+        };
+
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class SlabAVLTree<Key, Value>;
+        iterator(const typename PooledAVLTree<Key, slot_type>::iterator& keyIt, std::vector<Value>* values);
+        typename PooledAVLTree<Key, slot_type>::iterator keyIt_;
+        std::vector<Value>* values_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    std::pair<iterator, bool> internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite);
+
+    PooledAVLTree<Key, slot_type> keys_;
+    std::vector<Value> values_;
+    std::vector<slot_type> freeSlots_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the SlabAVLTree::iterator
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+SlabAVLTree<Key, Value>::iterator::iterator() :
+    values_(NULL)
+{
+
+}
+
+template<class Key, class Value>
+SlabAVLTree<Key, Value>::iterator::iterator(
+    const typename PooledAVLTree<Key, slot_type>::iterator& keyIt, std::vector<Value>* values) :
+    keyIt_(keyIt), values_(values)
+{
+
+}
+
+/**
+* Provides access to the key and, through the slab, the value.
+*/
+template<class Key, class Value>
+typename SlabAVLTree<Key, Value>::iterator::reference
+SlabAVLTree<Key, Value>::iterator::operator*() const
+{
+    return reference(keyIt_->first, (*values_)[keyIt_->second]);
+}
+
+template<class Key, class Value>
+typename SlabAVLTree<Key, Value>::iterator::pointer
+SlabAVLTree<Key, Value>::iterator::operator->() const
+{
+    pointer p = { **this };
+    return p;
+}
+
+template<class Key, class Value>
+bool SlabAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return keyIt_ == rhs.keyIt_;
+}
+
+template<class Key, class Value>
+bool SlabAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return keyIt_ != rhs.keyIt_;
+}
+
+/**
+* Advances in key order; no value is touched.
+*/
+template<class Key, class Value>
+typename SlabAVLTree<Key, Value>::iterator&
+SlabAVLTree<Key, Value>::iterator::operator++()
+{
+    ++keyIt_;
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SlabAVLTree::iterator
+  -----------------------------------------------
+*/
+
+/*
+  --------------------------------------------
+  Begin implementations for the SlabAVLTree class.
+  --------------------------------------------
+*/
+
+template<class Key, class Value>
+SlabAVLTree<Key, Value>::SlabAVLTree()
+{
+
+}
+
+template<class Key, class Value>
+bool SlabAVLTree<Key, Value>::empty() const
+{
+    return keys_.empty();
+}
+
+template<class Key, class Value>
+size_t SlabAVLTree<Key, Value>::size() const
+{
+    return keys_.size();
+}
+
+/**
+* Pre-sizes both the key pool and the value slab.
+*/
+template<class Key, class Value>
+void SlabAVLTree<Key, Value>::reserve(size_t n)
+{
+    keys_.reserve(n);
+    values_.reserve(n);
+}
+
+template<class Key, class Value>
+void SlabAVLTree<Key, Value>::clear()
+{
+    keys_.clear();
+    values_.clear();
+    freeSlots_.clear();
+}
+
+template<class Key, class Value>
+typename SlabAVLTree<Key, Value>::iterator
+SlabAVLTree<Key, Value>::begin() const
+{
+    return iterator(keys_.begin(), const_cast<std::vector<Value>*>(&values_));
+}
+
+template<class Key, class Value>
+typename SlabAVLTree<Key, Value>::iterator
+SlabAVLTree<Key, Value>::end() const
+{
+    return iterator(keys_.end(), const_cast<std::vector<Value>*>(&values_));
+}
+
+template<class Key, class Value>
+typename SlabAVLTree<Key, Value>::iterator
+SlabAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(keys_.find(key), const_cast<std::vector<Value>*>(&values_));
+}
+
+/**
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent.
+ */
+template<class Key, class Value>
+Value& SlabAVLTree<Key, Value>::operator[](const Key& key)
+{
+    return internalInsert(std::make_pair(key, Value()), false).first->second;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value const & SlabAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    return values_[keys_[key]];
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Returns an iterator to the item and whether it was inserted.
+ */
+template<class Key, class Value>
+std::pair<typename SlabAVLTree<Key, Value>::iterator, bool>
+SlabAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    return internalInsert(keyValuePair, true);
+}
+
+/**
+* Inserts keyValuePair only if its key is absent. Either way returns an
+* iterator to the key's item and whether it was inserted.
+*/
+template<class Key, class Value>
+std::pair<typename SlabAVLTree<Key, Value>::iterator, bool>
+SlabAVLTree<Key, Value>::find_or_insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    return internalInsert(keyValuePair, false);
+}
+
+/**
+* The key tree is searched once: the slot a new key would get is offered
+* up front and only claimed if the key turns out to be new. An existing
+* key's value is replaced only if overwrite is set.
+*/
+template<class Key, class Value>
+std::pair<typename SlabAVLTree<Key, Value>::iterator, bool>
+SlabAVLTree<Key, Value>::internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite)
+{
+    slot_type slot = freeSlots_.empty() ? static_cast<slot_type>(values_.size()) : freeSlots_.back();
+    std::pair<typename PooledAVLTree<Key, slot_type>::iterator, bool> result =
+        keys_.find_or_insert(std::make_pair(keyValuePair.first, slot));
+    if (!result.second) {
+        if (overwrite) {
+            values_[result.first->second] = keyValuePair.second;
+        }
+    }
+    else if (freeSlots_.empty()) {
+        values_.push_back(keyValuePair.second);
+    }
+    else {
+        freeSlots_.pop_back();
+        values_[slot] = keyValuePair.second;
+    }
+    return std::make_pair(iterator(result.first, &values_), result.second);
+}
+
+/**
+* Removes the key and recycles its slot. The slot is reset to a
+* default value so that whatever the old value owned is released now.
+*/
+template<class Key, class Value>
+void SlabAVLTree<Key, Value>::remove(const Key& key)
+{
+    typename PooledAVLTree<Key, slot_type>::iterator it = keys_.find(key);
+    if (it == keys_.end()) {
+        return;
+    }
+    slot_type slot = it->second;
+    keys_.erase(it);
+    values_[slot] = Value();
+    freeSlots_.push_back(slot);
+}
+
+/*
+  ------------------------------------------
+  End implementations for the SlabAVLTree class.
+  ------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,404 @@
+#ifndef SMALLAVL_H
+#define SMALLAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "avlbst.h"
+
+/**
+* A map that stores up to N entries in a sorted array inside the object itself
+* and only becomes a heap-allocated AVLTree once it grows past N. Holding many
+* tiny maps then costs no allocation per entry, and lookups in the inline
+* array are a short linear scan over contiguous pairs.
+*
+* Once promoted the map stays tree-backed until clear(). The interface follows
+* BinarySearchTree's.
+*/
+template <typename Key, typename Value, size_t N = 8>
+class SmallAVLMap
+{
+public:
+    typedef std::pair<const Key, Value> value_type;
+
+    SmallAVLMap();
+    ~SmallAVLMap();
+
+    class iterator;
+
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    bool isInline() const;
+
+    /**
+    * An iterator over either the inline array or the promoted tree.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class SmallAVLMap<Key, Value, N>;
+        iterator(value_type* slot);
+        iterator(const typename AVLTree<Key, Value>::iterator& treeIt);
+
+        value_type* slot_;  // position in the inline array, NULL when tree-backed
+        typename AVLTree<Key, Value>::iterator treeIt_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type Slot;
+
+    value_type* slot(size_t i) const;
+    size_t lowerBound(const Key& key) const;
+    void promote();
+
+    Slot inline_[N];
+    size_t count_;             // entries in inline_ (0 once promoted)
+    AVLTree<Key, Value>* tree_;
+    size_t size_;
+
+private:
+    SmallAVLMap(const SmallAVLMap&);
+    SmallAVLMap& operator=(const SmallAVLMap&);
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the SmallAVLMap::iterator
+  -------------------------------------------------
+*/
+
+template<class Key, class Value, size_t N>
+SmallAVLMap<Key, Value, N>::iterator::iterator() :
+    slot_(NULL)
+{
+
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLMap<Key, Value, N>::iterator::iterator(value_type* slot) :
+    slot_(slot)
+{
+
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLMap<Key, Value, N>::iterator::iterator(const typename AVLTree<Key, Value>::iterator& treeIt) :
+    slot_(NULL), treeIt_(treeIt)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value, size_t N>
+std::pair<const Key,Value>&
+SmallAVLMap<Key, Value, N>::iterator::operator*() const
+{
+    return slot_ != NULL ? *slot_ : *treeIt_;
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value, size_t N>
+std::pair<const Key,Value>*
+SmallAVLMap<Key, Value, N>::iterator::operator->() const
+{
+    return &(**this);
+}
+
+template<class Key, class Value, size_t N>
+bool SmallAVLMap<Key, Value, N>::iterator::operator==(const iterator& rhs) const
+{
+    return slot_ == rhs.slot_ && treeIt_ == rhs.treeIt_;
+}
+
+template<class Key, class Value, size_t N>
+bool SmallAVLMap<Key, Value, N>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances the iterator. Inline positions run up to one past the last
+* entry, which end() also points at.
+*/
+template<class Key, class Value, size_t N>
+typename SmallAVLMap<Key, Value, N>::iterator&
+SmallAVLMap<Key, Value, N>::iterator::operator++()
+{
+    if (slot_ != NULL) {
+        ++slot_;
+    }
+    else {
+        ++treeIt_;
+    }
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SmallAVLMap::iterator
+  -----------------------------------------------
+*/
+
+/*
+  --------------------------------------------
+  Begin implementations for the SmallAVLMap class.
+  --------------------------------------------
+*/
+
+template<class Key, class Value, size_t N>
+SmallAVLMap<Key, Value, N>::SmallAVLMap() :
+    count_(0), tree_(NULL), size_(0)
+{
+
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLMap<Key, Value, N>::~SmallAVLMap()
+{
+    clear();
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLMap<Key, Value, N>::value_type*
+SmallAVLMap<Key, Value, N>::slot(size_t i) const
+{
+    return reinterpret_cast<value_type*>(const_cast<Slot*>(&inline_[i]));
+}
+
+template<class Key, class Value, size_t N>
+bool SmallAVLMap<Key, Value, N>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Key, class Value, size_t N>
+size_t SmallAVLMap<Key, Value, N>::size() const
+{
+    return size_;
+}
+
+/**
+* Returns true while the entries still live in the inline array.
+*/
+template<class Key, class Value, size_t N>
+bool SmallAVLMap<Key, Value, N>::isInline() const
+{
+    return tree_ == NULL;
+}
+
+/**
+* Destroys every entry, frees the tree if there is one and returns
+* to inline storage.
+*/
+template<class Key, class Value, size_t N>
+void SmallAVLMap<Key, Value, N>::clear()
+{
+    for (size_t i = 0; i < count_; ++i) {
+        slot(i)->~value_type();
+    }
+    count_ = 0;
+    delete tree_;
+    tree_ = NULL;
+    size_ = 0;
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLMap<Key, Value, N>::iterator
+SmallAVLMap<Key, Value, N>::begin() const
+{
+    if (tree_ != NULL) {
+        return iterator(tree_->begin());
+    }
+    return iterator(slot(0));
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLMap<Key, Value, N>::iterator
+SmallAVLMap<Key, Value, N>::end() const
+{
+    if (tree_ != NULL) {
+        return iterator(tree_->end());
+    }
+    return iterator(slot(0) + count_);
+}
+
+/**
+* Returns the first inline position whose key is not less than key.
+* A plain forward scan: for N around 8 this beats a binary search
+* and the compiler can unroll it.
+*/
+template<class Key, class Value, size_t N>
+size_t SmallAVLMap<Key, Value, N>::lowerBound(const Key& key) const
+{
+    size_t i = 0;
+    while (i < count_ && slot(i)->first < key) {
+        ++i;
+    }
+    return i;
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLMap<Key, Value, N>::iterator
+SmallAVLMap<Key, Value, N>::find(const Key& key) const
+{
+    if (tree_ != NULL) {
+        return iterator(tree_->find(key));
+    }
+    size_t i = lowerBound(key);
+    if (i < count_ && !(key < slot(i)->first)) {
+        return iterator(slot(i));
+    }
+    return end();
+}
+
+/**
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent
+ */
+template<class Key, class Value, size_t N>
+Value& SmallAVLMap<Key, Value, N>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if (it == end()) {
+        it = insert(std::make_pair(key, Value())).first;
+    }
+    return it->second;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, size_t N>
+Value const & SmallAVLMap<Key, Value, N>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+/**
+* Moves the inline entries into a new AVLTree. They are already sorted,
+* so each one goes through the tree's append fast path. The inline
+* entries are only destroyed once all of them are in the tree, so if an
+* insert throws the map is left inline and unchanged.
+*/
+template<class Key, class Value, size_t N>
+void SmallAVLMap<Key, Value, N>::promote()
+{
+    AVLTree<Key, Value>* tree = new AVLTree<Key, Value>();
+    try {
+        for (size_t i = 0; i < count_; ++i) {
+            tree->insert(tree->end(), *slot(i));
+        }
+    }
+    catch (...) {
+        delete tree;
+        throw;
+    }
+    for (size_t i = 0; i < count_; ++i) {
+        slot(i)->~value_type();
+    }
+    count_ = 0;
+    tree_ = tree;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Returns an iterator to the item and whether it was inserted.
+ */
+template<class Key, class Value, size_t N>
+std::pair<typename SmallAVLMap<Key, Value, N>::iterator, bool>
+SmallAVLMap<Key, Value, N>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if (tree_ == NULL) {
+        size_t i = lowerBound(keyValuePair.first);
+        if (i < count_ && !(keyValuePair.first < slot(i)->first)) {
+            slot(i)->second = keyValuePair.second;
+            return std::make_pair(iterator(slot(i)), false);
+        }
+        if (count_ < N) {
+            // Shift the tail up one slot; keys are const, so entries are
+            // re-constructed rather than assigned.
+            for (size_t j = count_; j > i; --j) {
+                new (slot(j)) value_type(std::move(*slot(j - 1)));
+                slot(j - 1)->~value_type();
+            }
+            new (slot(i)) value_type(keyValuePair);
+            ++count_;
+            ++size_;
+            return std::make_pair(iterator(slot(i)), true);
+        }
+        promote();
+    }
+    std::pair<typename AVLTree<Key, Value>::iterator, bool> result = tree_->insert(keyValuePair);
+    if (result.second) {
+        ++size_;
+    }
+    return std::make_pair(iterator(result.first), result.second);
+}
+
+/**
+* Removes the key if present, closing the gap in the inline array.
+*/
+template<class Key, class Value, size_t N>
+void SmallAVLMap<Key, Value, N>::remove(const Key& key)
+{
+    if (tree_ != NULL) {
+        typename AVLTree<Key, Value>::iterator it = tree_->find(key);
+        if (it != tree_->end()) {
+            tree_->erase(it);
+            --size_;
+        }
+        return;
+    }
+    size_t i = lowerBound(key);
+    if (i == count_ || key < slot(i)->first) {
+        return;
+    }
+    slot(i)->~value_type();
+    for (size_t j = i + 1; j < count_; ++j) {
+        new (slot(j - 1)) value_type(std::move(*slot(j)));
+        slot(j)->~value_type();
+    }
+    --count_;
+    --size_;
+}
+
+/*
+  ------------------------------------------
+  End implementations for the SmallAVLMap class.
+  ------------------------------------------
+*/
+
+#endif
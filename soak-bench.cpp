@@ -0,0 +1,223 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+/*
+ * Soak test for BinarySearchTree and AVLTree under adversarial key
+ * sequences. Each pattern is turned into a fixed list of inserts, finds
+ * and removes, which both trees then run with every operation timed on
+ * its own. For each pattern and tree the benchmark prints the latency
+ * percentiles per operation type and the tree height sampled at ten
+ * points during the run.
+ *
+ * The patterns:
+ *   random    shuffled keys, the baseline
+ *   sorted    ascending keys
+ *   reverse   descending keys
+ *   zigzag    alternately the lowest and highest remaining key
+ *   sawtooth  short ascending runs that each sweep the whole key range
+ *   zipf-hot  finds, inserts and removes on zipf-distributed keys
+ *   pred-storm  random keys, then removing the oldest key (near the root,
+ *             so it has two children and is swapped with its
+ *             predecessor) and inserting a new one, over and over
+ *
+ * The first five stream keys through a window: each key is inserted, a
+ * key still in the window is looked up, and the key that falls out of
+ * the window is removed.
+ *
+ * Usage: soak-bench [operations per pattern, default 20000]
+ */
+
+enum OpType { INSERT, FIND, REMOVE, OP_TYPES };
+
+static const char* const opNames[OP_TYPES] = { "insert", "find", "remove" };
+
+struct Op
+{
+    OpType type;
+    int key;
+};
+
+// Find results are summed into a global so the compiler cannot drop the
+// timed calls.
+long found = 0;
+
+static vector<Op> windowed(const vector<int>& keys, mt19937& rng)
+{
+    size_t window = max<size_t>(keys.size() / 4, 1);
+    vector<Op> ops;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Op insert = { INSERT, keys[i] };
+        ops.push_back(insert);
+        Op find = { FIND, keys[i - rng() % min(i + 1, window)] };
+        ops.push_back(find);
+        if (i >= window) {
+            Op remove = { REMOVE, keys[i - window] };
+            ops.push_back(remove);
+        }
+    }
+    return ops;
+}
+
+static vector<Op> zipfHot(size_t n, mt19937& rng)
+{
+    // Ranks follow zipf with exponent 1.1; rank r maps to a scattered key
+    // so the hot keys are spread over the tree.
+    vector<double> cdf(n);
+    double sum = 0;
+    for (size_t r = 0; r < n; ++r) {
+        sum += 1.0 / pow(r + 1.0, 1.1);
+        cdf[r] = sum;
+    }
+    uniform_real_distribution<double> unit(0, sum);
+    vector<Op> ops;
+    for (size_t i = 0; i < n; ++i) {
+        size_t rank = lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin();
+        int key = (int)((rank * 2654435761u) % (4 * n));
+        unsigned choice = rng() % 4;
+        Op op = { choice < 2 ? FIND : choice == 2 ? INSERT : REMOVE, key };
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+static vector<Op> predecessorStorm(size_t n, mt19937& rng)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (int)i;
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+    size_t live = n / 2;
+    vector<Op> ops;
+    for (size_t i = 0; i < live; ++i) {
+        Op insert = { INSERT, keys[i] };
+        ops.push_back(insert);
+    }
+    for (size_t i = live; i < n; ++i) {
+        Op remove = { REMOVE, keys[i - live] };
+        ops.push_back(remove);
+        Op insert = { INSERT, keys[i] };
+        ops.push_back(insert);
+    }
+    return ops;
+}
+
+static vector<Op> makePattern(const string& name, size_t n, mt19937& rng)
+{
+    if (name == "zipf-hot") {
+        return zipfHot(n, rng);
+    }
+    if (name == "pred-storm") {
+        return predecessorStorm(n, rng);
+    }
+    vector<int> keys(n);
+    size_t teeth = 64;
+    size_t toothSpan = (n + teeth - 1) / teeth;
+    for (size_t i = 0; i < n; ++i) {
+        if (name == "reverse") {
+            keys[i] = (int)(n - 1 - i);
+        }
+        else if (name == "zigzag") {
+            keys[i] = (int)(i % 2 == 0 ? i / 2 : n - 1 - i / 2);
+        }
+        else if (name == "sawtooth") {
+            keys[i] = (int)((i % teeth) * toothSpan + i / teeth);
+        }
+        else {
+            keys[i] = (int)i;
+        }
+    }
+    if (name == "random") {
+        shuffle(keys.begin(), keys.end(), rng);
+    }
+    return windowed(keys, rng);
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)(p * (sorted.size() - 1));
+    return sorted[rank];
+}
+
+/**
+ * Runs the operations on a fresh tree, printing one line of latency
+ * percentiles per operation type and then the sampled heights.
+ */
+template <typename Tree>
+void soak(const char* pattern, const char* name, const vector<Op>& ops)
+{
+    Tree tree;
+    vector<double> latencies[OP_TYPES];
+    vector<int> heights;
+    size_t sampleEvery = max<size_t>(ops.size() / 10, 1);
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const Op& op = ops[i];
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (op.type == INSERT) {
+            tree.insert(std::make_pair(op.key, (int)i));
+        }
+        else if (op.type == FIND) {
+            found += tree.find(op.key) != tree.end();
+        }
+        else {
+            tree.remove(op.key);
+        }
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+        latencies[op.type].push_back(chrono::duration<double, nano>(stop - start).count());
+        if ((i + 1) % sampleEvery == 0) {
+            heights.push_back(tree.height());
+        }
+    }
+
+    for (int t = 0; t < OP_TYPES; ++t) {
+        if (latencies[t].empty()) {
+            continue;
+        }
+        sort(latencies[t].begin(), latencies[t].end());
+        cout << left << setw(12) << pattern << setw(6) << name << setw(8) << opNames[t] << right
+             << fixed << setprecision(0)
+             << setw(10) << percentile(latencies[t], 0.5)
+             << setw(10) << percentile(latencies[t], 0.99)
+             << setw(10) << percentile(latencies[t], 0.999)
+             << setw(12) << latencies[t].back() << endl;
+    }
+    cout << left << setw(12) << pattern << setw(6) << name << setw(8) << "height" << right;
+    for (size_t i = 0; i < heights.size(); ++i) {
+        cout << " " << heights[i];
+    }
+    cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000;
+    static const char* const patterns[] = {
+        "random", "sorted", "reverse", "zigzag", "sawtooth", "zipf-hot", "pred-storm"
+    };
+
+    cout << n << " keys per pattern, latency in ns (including the clock reads)" << endl;
+    cout << left << setw(26) << "" << right << setw(10) << "p50" << setw(10) << "p99"
+         << setw(10) << "p99.9" << setw(12) << "max" << endl;
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+        mt19937 rng(11);
+        vector<Op> ops = makePattern(patterns[p], n, rng);
+        soak<BinarySearchTree<int, int> >(patterns[p], "BST", ops);
+        soak<AVLTree<int, int> >(patterns[p], "AVL", ops);
+    }
+    return found == -1;
+}
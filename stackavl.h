@@ -0,0 +1,575 @@
+#ifndef STACKAVL_H
+#define STACKAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+
+/**
+* A node for StackAVLTree. Unlike Node/AVLNode there is no parent pointer;
+* the tree remembers the search path instead.
+*/
+template <typename Key, typename Value>
+struct StackAVLNode
+{
+    StackAVLNode(const Key& key, const Value& value);
+
+    std::pair<const Key, Value> item;
+    StackAVLNode<Key, Value>* child[2];   // 0 = left, 1 = right
+    int8_t balance;
+};
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>::StackAVLNode(const Key& key, const Value& value) :
+    item(key, value), balance(0)
+{
+    child[0] = NULL;
+    child[1] = NULL;
+}
+
+/**
+* An AVL tree without parent links. insert and remove record the path from the
+* root in a fixed-size array and walk it backwards to rebalance, and iterators
+* carry the stack of ancestors still to be visited. This saves a pointer per
+* node and the parent_ writes every rotation would otherwise make.
+*
+* MAX_HEIGHT bounds every path: an AVL tree of height 64 already needs more
+* than 10^13 nodes.
+*/
+template <typename Key, typename Value>
+class StackAVLTree
+{
+public:
+    static const int MAX_HEIGHT = 64;
+
+    class iterator;
+
+    StackAVLTree();
+    ~StackAVLTree();
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair);
+    std::pair<iterator, bool> find_or_insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+    /**
+    * An in-order iterator holding the stack of ancestors whose items
+    * are still to be visited. The top of the stack is the current node.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class StackAVLTree<Key, Value>;
+        void pushLeftSpine(StackAVLNode<Key, Value>* node);
+        StackAVLNode<Key, Value>* current() const;
+
+        StackAVLNode<Key, Value>* stack_[MAX_HEIGHT];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef StackAVLNode<Key, Value> NodeType;
+
+    NodeType* internalFind(const Key& key) const;
+    std::pair<iterator, bool> internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite);
+    iterator pathIterator(NodeType* const* path, const int* dirs, int depth,
+                          NodeType* from, const Key& key) const;
+    static NodeType* rotate(NodeType* x, int dir);
+    static NodeType* rebalance(NodeType* z);
+    void clearHelper(NodeType* node);
+
+    NodeType* root_;
+    size_t size_;
+
+private:
+    StackAVLTree(const StackAVLTree&);
+    StackAVLTree& operator=(const StackAVLTree&);
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the StackAVLTree::iterator
+  ---------------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+/**
+* Pushes node and its chain of left descendants, leaving the
+* smallest of them on top.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::iterator::pushLeftSpine(StackAVLNode<Key, Value>* node)
+{
+    while (node != NULL) {
+        stack_[depth_++] = node;
+        node = node->child[0];
+    }
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLTree<Key, Value>::iterator::current() const
+{
+    return depth_ == 0 ? NULL : stack_[depth_ - 1];
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value>&
+StackAVLTree<Key, Value>::iterator::operator*() const
+{
+    return stack_[depth_ - 1]->item;
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value>*
+StackAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(stack_[depth_ - 1]->item);
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Advances the iterator's location using an in-order sequencing.
+* Pops the current node and, if it has a right subtree, pushes that
+* subtree's left spine; otherwise the next ancestor is already on top.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator&
+StackAVLTree<Key, Value>::iterator::operator++()
+{
+    StackAVLNode<Key, Value>* node = stack_[--depth_];
+    pushLeftSpine(node->child[1]);
+    return *this;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the StackAVLTree::iterator
+  -------------------------------------------------
+*/
+
+/*
+  ----------------------------------------------
+  Begin implementations for the StackAVLTree class.
+  ----------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::StackAVLTree() :
+    root_(NULL), size_(0)
+{
+
+}
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::~StackAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value>
+size_t StackAVLTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clearHelper(NodeType* node)
+{
+    if (node == NULL) {
+        return;
+    }
+    clearHelper(node->child[0]);
+    clearHelper(node->child[1]);
+    delete node;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+    size_ = 0;
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end().
+* The descent records every node passed on the way down whose
+* item comes later, which is exactly the iterator's stack.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::find(const Key& key) const
+{
+    iterator it;
+    NodeType* active = root_;
+    while (active != NULL) {
+        if (key < active->item.first) {
+            it.stack_[it.depth_++] = active;
+            active = active->child[0];
+        }
+        else if (active->item.first < key) {
+            active = active->child[1];
+        }
+        else {
+            it.stack_[it.depth_++] = active;
+            return it;
+        }
+    }
+    return end();
+}
+
+/**
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent.
+ */
+template<class Key, class Value>
+Value& StackAVLTree<Key, Value>::operator[](const Key& key)
+{
+    return internalInsert(std::make_pair(key, Value()), false).first->second;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value const & StackAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    NodeType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->item.second;
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    NodeType* active = root_;
+    while (active != NULL) {
+        if (key < active->item.first) {
+            active = active->child[0];
+        }
+        else if (active->item.first < key) {
+            active = active->child[1];
+        }
+        else {
+            return active;
+        }
+    }
+    return NULL;
+}
+
+/**
+* Rotates x's child on side dir up into x's place (dir 1 is a left
+* rotation) and returns it. The caller re-attaches the result.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::rotate(NodeType* x, int dir)
+{
+    NodeType* y = x->child[dir];
+    x->child[dir] = y->child[1 - dir];
+    y->child[1 - dir] = x;
+    return y;
+}
+
+/**
+* Restores the AVL property at z, whose balance has reached +2 or -2.
+* Returns the root of the rebalanced subtree; its balance is 0 iff
+* the subtree got shorter.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::rebalance(NodeType* z)
+{
+    int dir = (z->balance > 0) ? 1 : 0;
+    int8_t sign = dir ? 1 : -1;
+    NodeType* c = z->child[dir];
+    if (c->balance != -sign) { // single rotation (c->balance is 0 only during removal)
+        rotate(z, dir);
+        if (c->balance == 0) { z->balance = sign; c->balance = -sign; }
+        else { z->balance = 0; c->balance = 0; }
+        return c;
+    }
+    NodeType* g = c->child[1 - dir]; // double rotation
+    z->child[dir] = rotate(c, 1 - dir);
+    rotate(z, dir);
+    if (g->balance == sign) { z->balance = -sign; c->balance = 0; }
+    else if (g->balance == -sign) { z->balance = 0; c->balance = sign; }
+    else { z->balance = 0; c->balance = 0; }
+    g->balance = 0;
+    return g;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Returns an iterator to the item and whether a new node was created.
+ */
+template<class Key, class Value>
+std::pair<typename StackAVLTree<Key, Value>::iterator, bool>
+StackAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    return internalInsert(keyValuePair, true);
+}
+
+/**
+* Inserts keyValuePair only if its key is absent. Either way returns an
+* iterator to the key's item and whether it was inserted.
+*/
+template<class Key, class Value>
+std::pair<typename StackAVLTree<Key, Value>::iterator, bool>
+StackAVLTree<Key, Value>::find_or_insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    return internalInsert(keyValuePair, false);
+}
+
+/**
+* Descends once, attaching a new leaf or stopping at the existing node
+* (whose value is replaced only if overwrite is set). The iterator is
+* built from the recorded path; only below a rotation, if there was one,
+* does it need a short descent of its own.
+*/
+template<class Key, class Value>
+std::pair<typename StackAVLTree<Key, Value>::iterator, bool>
+StackAVLTree<Key, Value>::internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite)
+{
+    NodeType* path[MAX_HEIGHT];
+    int dirs[MAX_HEIGHT];
+    int depth = 0;
+
+    const Key& key = keyValuePair.first;
+    NodeType** link = &root_;
+    while (*link != NULL) {
+        NodeType* active = *link;
+        int dir;
+        if (key < active->item.first) {
+            dir = 0;
+        }
+        else if (active->item.first < key) {
+            dir = 1;
+        }
+        else {
+            if (overwrite) {
+                active->item.second = keyValuePair.second;
+            }
+            return std::make_pair(pathIterator(path, dirs, depth, active, key), false);
+        }
+        path[depth] = active;
+        dirs[depth] = dir;
+        ++depth;
+        link = &active->child[dir];
+    }
+    NodeType* node = *link = new NodeType(key, keyValuePair.second);
+    ++size_;
+
+    int unchanged = depth;  // path[0, unchanged) keeps its shape
+    NodeType* below = node; // the subtree under them that holds node
+    while (depth > 0) {
+        --depth;
+        NodeType* parent = path[depth];
+        parent->balance += dirs[depth] ? 1 : -1;
+        if (parent->balance == 0) {
+            break;
+        }
+        if (parent->balance == 2 || parent->balance == -2) {
+            NodeType* top = rebalance(parent);
+            if (depth == 0) root_ = top;
+            else path[depth - 1]->child[dirs[depth - 1]] = top;
+            unchanged = depth;
+            below = top;
+            break; // A rotation always finishes the balancing for insert
+        }
+    }
+    return std::make_pair(pathIterator(path, dirs, unchanged, below, key), true);
+}
+
+/**
+* Builds the iterator for key from a recorded search path: the first depth
+* nodes of path, of which those left by their left link come later in
+* order, then a descent from from, which must hold key in its subtree.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::pathIterator(NodeType* const* path, const int* dirs, int depth,
+                                       NodeType* from, const Key& key) const
+{
+    iterator it;
+    for (int i = 0; i < depth; ++i) {
+        if (dirs[i] == 0) {
+            it.stack_[it.depth_++] = path[i];
+        }
+    }
+    NodeType* active = from;
+    while (true) {
+        if (key < active->item.first) {
+            it.stack_[it.depth_++] = active;
+            active = active->child[0];
+        }
+        else if (active->item.first < key) {
+            active = active->child[1];
+        }
+        else {
+            it.stack_[it.depth_++] = active;
+            return it;
+        }
+    }
+}
+
+/*
+ * If a node has 2 children it is replaced by its predecessor
+ * before being unlinked.
+ */
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::remove(const Key& key)
+{
+    NodeType* path[MAX_HEIGHT];
+    int dirs[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* found = root_;
+    while (found != NULL) {
+        int dir;
+        if (key < found->item.first) {
+            dir = 0;
+        }
+        else if (found->item.first < key) {
+            dir = 1;
+        }
+        else {
+            break;
+        }
+        path[depth] = found;
+        dirs[depth] = dir;
+        ++depth;
+        found = found->child[dir];
+    }
+    if (found == NULL) {
+        return;
+    }
+
+    if (found->child[0] != NULL && found->child[1] != NULL) {
+        // Extend the path down to the predecessor, then move the
+        // predecessor into found's slot so found ends up with <= 1 child.
+        int foundDepth = depth;
+        path[depth] = found;
+        dirs[depth] = 0;
+        ++depth;
+        NodeType* pred = found->child[0];
+        while (pred->child[1] != NULL) {
+            path[depth] = pred;
+            dirs[depth] = 1;
+            ++depth;
+            pred = pred->child[1];
+        }
+
+        NodeType* predParent = path[depth - 1];
+        if (foundDepth == 0) root_ = pred;
+        else path[foundDepth - 1]->child[dirs[foundDepth - 1]] = pred;
+        NodeType* predLeft = pred->child[0];
+        pred->child[1] = found->child[1];
+        pred->child[0] = (predParent == found) ? found : found->child[0];
+        std::swap(pred->balance, found->balance);
+        if (predParent != found) predParent->child[1] = found;
+        found->child[0] = predLeft;
+        found->child[1] = NULL;
+        path[foundDepth] = pred;
+    }
+
+    NodeType* child = (found->child[0] != NULL) ? found->child[0] : found->child[1];
+    if (depth == 0) root_ = child;
+    else path[depth - 1]->child[dirs[depth - 1]] = child;
+    delete found;
+    --size_;
+
+    while (depth > 0) {
+        --depth;
+        NodeType* curr = path[depth];
+        curr->balance += dirs[depth] ? -1 : 1;
+        if (curr->balance == 1 || curr->balance == -1) {
+            break;
+        }
+        if (curr->balance == 2 || curr->balance == -2) {
+            curr = rebalance(curr);
+            if (depth == 0) root_ = curr;
+            else path[depth - 1]->child[dirs[depth - 1]] = curr;
+            if (curr->balance != 0) {
+                break; // Height stabilized
+            }
+        }
+    }
+}
+
+/*
+  --------------------------------------------
+  End implementations for the StackAVLTree class.
+  --------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,658 @@
+#ifndef THREADAVL_H
+#define THREADAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+
+/**
+* A node for ThreadedAVLTree. A child link whose bit is set in threads is not
+* a child at all but a thread: child[0] then points at the in-order
+* predecessor and child[1] at the in-order successor (NULL past either end).
+*/
+template <typename Key, typename Value>
+struct ThreadedAVLNode
+{
+    static const uint8_t LEFT_THREAD = 1;
+    static const uint8_t RIGHT_THREAD = 2;
+
+    ThreadedAVLNode(const Key& key, const Value& value);
+    bool isThread(int dir) const;
+    void setThread(int dir, bool thread);
+
+    std::pair<const Key, Value> item;
+    ThreadedAVLNode<Key, Value>* child[2];   // 0 = left, 1 = right
+    int8_t balance;
+    uint8_t threads;
+};
+
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>::ThreadedAVLNode(const Key& key, const Value& value) :
+    item(key, value), balance(0), threads(LEFT_THREAD | RIGHT_THREAD)
+{
+    child[0] = NULL;
+    child[1] = NULL;
+}
+
+template<class Key, class Value>
+bool ThreadedAVLNode<Key, Value>::isThread(int dir) const
+{
+    return (threads & (dir ? RIGHT_THREAD : LEFT_THREAD)) != 0;
+}
+
+template<class Key, class Value>
+void ThreadedAVLNode<Key, Value>::setThread(int dir, bool thread)
+{
+    uint8_t bit = dir ? RIGHT_THREAD : LEFT_THREAD;
+    if (thread) threads |= bit;
+    else threads &= ~bit;
+}
+
+/**
+* An AVL tree whose empty child links are threads to the in-order neighbours.
+* An iterator step is a single hop whenever the current node has no right
+* child, and otherwise a walk down the left spine of the right subtree; it
+* never climbs back up, so a full scan touches every link exactly once and
+* needs no parent pointers. insert and remove keep the threads correct
+* through rotations, using a recorded search path (as StackAVLTree does)
+* in place of parent links.
+*/
+template <typename Key, typename Value>
+class ThreadedAVLTree
+{
+public:
+    static const int MAX_HEIGHT = 64;
+
+    class iterator;
+
+    ThreadedAVLTree();
+    ~ThreadedAVLTree();
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair);
+    std::pair<iterator, bool> find_or_insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+    /**
+    * An iterator that follows threads; -- steps backwards the same way.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+        iterator& operator--();
+
+    protected:
+        friend class ThreadedAVLTree<Key, Value>;
+        iterator(ThreadedAVLNode<Key, Value>* ptr);
+        ThreadedAVLNode<Key, Value>* current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator max() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef ThreadedAVLNode<Key, Value> NodeType;
+
+    NodeType* internalFind(const Key& key) const;
+    std::pair<NodeType*, bool> internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite);
+    NodeType* extreme(int dir) const;
+    static NodeType* step(NodeType* node, int dir);
+    static NodeType* rotate(NodeType* x, int dir);
+    static NodeType* rebalance(NodeType* z);
+
+    NodeType* root_;
+    size_t size_;
+
+private:
+    ThreadedAVLTree(const ThreadedAVLTree&);
+    ThreadedAVLTree& operator=(const ThreadedAVLTree&);
+};
+
+/*
+  ------------------------------------------------------
+  Begin implementations for the ThreadedAVLTree::iterator
+  ------------------------------------------------------
+*/
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::iterator::iterator() :
+    current_(NULL)
+{
+
+}
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::iterator::iterator(ThreadedAVLNode<Key, Value>* ptr) :
+    current_(ptr)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value>&
+ThreadedAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current_->item;
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value>*
+ThreadedAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current_->item);
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances to the in-order successor.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator&
+ThreadedAVLTree<Key, Value>::iterator::operator++()
+{
+    current_ = step(current_, 1);
+    return *this;
+}
+
+/**
+* Moves back to the in-order predecessor; decrementing begin() gives end().
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator&
+ThreadedAVLTree<Key, Value>::iterator::operator--()
+{
+    current_ = step(current_, 0);
+    return *this;
+}
+
+/*
+  ----------------------------------------------------
+  End implementations for the ThreadedAVLTree::iterator
+  ----------------------------------------------------
+*/
+
+/*
+  -------------------------------------------------
+  Begin implementations for the ThreadedAVLTree class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::ThreadedAVLTree() :
+    root_(NULL), size_(0)
+{
+
+}
+
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::~ThreadedAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value>
+bool ThreadedAVLTree<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value>
+size_t ThreadedAVLTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+/**
+* Deletes every node in order. Each node's successor is found before the
+* node is freed and lies in its untouched right subtree or above it, so
+* no recursion or stack is needed.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::clear()
+{
+    NodeType* node = extreme(0);
+    while (node != NULL) {
+        NodeType* next = step(node, 1);
+        delete node;
+        node = next;
+    }
+    root_ = NULL;
+    size_ = 0;
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::begin() const
+{
+    return iterator(extreme(0));
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::end() const
+{
+    return iterator(NULL);
+}
+
+/**
+* Returns an iterator to the largest item, the starting point for
+* iterating backwards with --.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::max() const
+{
+    return iterator(extreme(1));
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(internalFind(key));
+}
+
+/**
+ * Returns the value associated with the key, first inserting a
+ * default-constructed value if the key is absent.
+ */
+template<class Key, class Value>
+Value& ThreadedAVLTree<Key, Value>::operator[](const Key& key)
+{
+    return internalInsert(std::make_pair(key, Value()), false).first->item.second;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value const & ThreadedAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    NodeType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->item.second;
+}
+
+/**
+* Returns the smallest (dir 0) or largest (dir 1) node, or NULL.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::NodeType*
+ThreadedAVLTree<Key, Value>::extreme(int dir) const
+{
+    NodeType* node = root_;
+    if (node == NULL) {
+        return NULL;
+    }
+    while (!node->isThread(dir)) {
+        node = node->child[dir];
+    }
+    return node;
+}
+
+/**
+* Returns node's in-order successor (dir 1) or predecessor (dir 0): the
+* thread itself if there is one, otherwise the nearest node of the subtree
+* on that side.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::NodeType*
+ThreadedAVLTree<Key, Value>::step(NodeType* node, int dir)
+{
+    bool thread = node->isThread(dir);
+    node = node->child[dir];
+    if (!thread) {
+        while (!node->isThread(1 - dir)) {
+            node = node->child[1 - dir];
+        }
+    }
+    return node;
+}
+
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::NodeType*
+ThreadedAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    NodeType* active = root_;
+    while (active != NULL) {
+        int dir;
+        if (key < active->item.first) {
+            dir = 0;
+        }
+        else if (active->item.first < key) {
+            dir = 1;
+        }
+        else {
+            return active;
+        }
+        if (active->isThread(dir)) {
+            return NULL;
+        }
+        active = active->child[dir];
+    }
+    return NULL;
+}
+
+/**
+* Rotates x's child on side dir up into x's place (dir 1 is a left
+* rotation) and returns it. If that child had no inner subtree, x's
+* link becomes a thread back to it. The caller re-attaches the result.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::NodeType*
+ThreadedAVLTree<Key, Value>::rotate(NodeType* x, int dir)
+{
+    NodeType* y = x->child[dir];
+    if (y->isThread(1 - dir)) {
+        x->child[dir] = y;
+        x->setThread(dir, true);
+    }
+    else {
+        x->child[dir] = y->child[1 - dir];
+    }
+    y->child[1 - dir] = x;
+    y->setThread(1 - dir, false);
+    return y;
+}
+
+/**
+* Restores the AVL property at z, whose balance has reached +2 or -2.
+* Returns the root of the rebalanced subtree; its balance is 0 iff
+* the subtree got shorter.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::NodeType*
+ThreadedAVLTree<Key, Value>::rebalance(NodeType* z)
+{
+    int dir = (z->balance > 0) ? 1 : 0;
+    int8_t sign = dir ? 1 : -1;
+    NodeType* c = z->child[dir];
+    if (c->balance != -sign) { // single rotation (c->balance is 0 only during removal)
+        rotate(z, dir);
+        if (c->balance == 0) { z->balance = sign; c->balance = -sign; }
+        else { z->balance = 0; c->balance = 0; }
+        return c;
+    }
+    NodeType* g = c->child[1 - dir]; // double rotation
+    z->child[dir] = rotate(c, 1 - dir);
+    rotate(z, dir);
+    if (g->balance == sign) { z->balance = -sign; c->balance = 0; }
+    else if (g->balance == -sign) { z->balance = 0; c->balance = sign; }
+    else { z->balance = 0; c->balance = 0; }
+    g->balance = 0;
+    return g;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Returns an iterator to the item and whether a new node was created.
+ */
+template<class Key, class Value>
+std::pair<typename ThreadedAVLTree<Key, Value>::iterator, bool>
+ThreadedAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::pair<NodeType*, bool> result = internalInsert(keyValuePair, true);
+    return std::make_pair(iterator(result.first), result.second);
+}
+
+/**
+* Inserts keyValuePair only if its key is absent. Either way returns an
+* iterator to the key's item and whether it was inserted.
+*/
+template<class Key, class Value>
+std::pair<typename ThreadedAVLTree<Key, Value>::iterator, bool>
+ThreadedAVLTree<Key, Value>::find_or_insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::pair<NodeType*, bool> result = internalInsert(keyValuePair, false);
+    return std::make_pair(iterator(result.first), result.second);
+}
+
+/**
+* Descends once, threading in a new leaf or stopping at the existing node
+* (whose value is replaced only if overwrite is set). Returns the node and
+* whether it is new. Rotations move nodes but never change which node
+* holds an item, so the leaf is still the answer after rebalancing.
+*/
+template<class Key, class Value>
+std::pair<typename ThreadedAVLTree<Key, Value>::NodeType*, bool>
+ThreadedAVLTree<Key, Value>::internalInsert(const std::pair<const Key, Value>& keyValuePair, bool overwrite)
+{
+    const Key& key = keyValuePair.first;
+    if (root_ == NULL) {
+        root_ = new NodeType(key, keyValuePair.second);
+        ++size_;
+        return std::make_pair(root_, true);
+    }
+
+    NodeType* path[MAX_HEIGHT];
+    int dirs[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* node;
+    NodeType* active = root_;
+    while (true) {
+        int dir;
+        if (key < active->item.first) {
+            dir = 0;
+        }
+        else if (active->item.first < key) {
+            dir = 1;
+        }
+        else {
+            if (overwrite) {
+                active->item.second = keyValuePair.second;
+            }
+            return std::make_pair(active, false);
+        }
+        path[depth] = active;
+        dirs[depth] = dir;
+        ++depth;
+        if (active->isThread(dir)) {
+            // The new leaf inherits active's thread on this side and
+            // threads back to active on the other.
+            node = new NodeType(key, keyValuePair.second);
+            node->child[dir] = active->child[dir];
+            node->child[1 - dir] = active;
+            active->child[dir] = node;
+            active->setThread(dir, false);
+            ++size_;
+            break;
+        }
+        active = active->child[dir];
+    }
+
+    while (depth > 0) {
+        --depth;
+        NodeType* parent = path[depth];
+        parent->balance += dirs[depth] ? 1 : -1;
+        if (parent->balance == 0) {
+            break;
+        }
+        if (parent->balance == 2 || parent->balance == -2) {
+            NodeType* top = rebalance(parent);
+            if (depth == 0) root_ = top;
+            else path[depth - 1]->child[dirs[depth - 1]] = top;
+            break; // A rotation always finishes the balancing for insert
+        }
+    }
+    return std::make_pair(node, true);
+}
+
+/*
+ * If a node has 2 children it is replaced by its predecessor. Besides the
+ * parent link, the only links into a node are the threads from its
+ * in-order neighbours, which are redirected as the node is unlinked.
+ */
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::remove(const Key& key)
+{
+    NodeType* path[MAX_HEIGHT];
+    int dirs[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* found = root_;
+    while (found != NULL) {
+        int dir;
+        if (key < found->item.first) {
+            dir = 0;
+        }
+        else if (found->item.first < key) {
+            dir = 1;
+        }
+        else {
+            break;
+        }
+        if (found->isThread(dir)) {
+            return;
+        }
+        path[depth] = found;
+        dirs[depth] = dir;
+        ++depth;
+        found = found->child[dir];
+    }
+    if (found == NULL) {
+        return;
+    }
+
+    NodeType* parent = (depth == 0) ? NULL : path[depth - 1];
+    int pdir = (depth == 0) ? 0 : dirs[depth - 1];
+    NodeType* replacement;
+
+    if (found->isThread(0)) {
+        if (!found->isThread(1)) {
+            // Only a right subtree: its smallest node threaded back to found.
+            replacement = found->child[1];
+            NodeType* t = replacement;
+            while (!t->isThread(0)) t = t->child[0];
+            t->child[0] = found->child[0];
+        }
+        else {
+            // A leaf: the parent's link becomes found's thread on that side.
+            replacement = NULL;
+            if (parent != NULL) {
+                parent->child[pdir] = found->child[pdir];
+                parent->setThread(pdir, true);
+            }
+            else {
+                root_ = NULL;
+            }
+        }
+        if (replacement != NULL) {
+            if (parent == NULL) root_ = replacement;
+            else parent->child[pdir] = replacement;
+        }
+    }
+    else {
+        NodeType* l = found->child[0];
+        int foundDepth = depth;
+        NodeType* pred;
+        if (l->isThread(1)) {
+            // The left child is the predecessor; it takes found's right side.
+            pred = l;
+            path[depth] = pred;
+            dirs[depth] = 0;
+            ++depth;
+        }
+        else {
+            // Walk down to the rightmost node of the left subtree.
+            path[depth] = NULL; // filled with pred below
+            dirs[depth] = 0;
+            ++depth;
+            NodeType* r = l;
+            pred = l->child[1];
+            path[depth] = r;
+            dirs[depth] = 1;
+            ++depth;
+            while (!pred->isThread(1)) {
+                r = pred;
+                path[depth] = r;
+                dirs[depth] = 1;
+                ++depth;
+                pred = pred->child[1];
+            }
+            if (!pred->isThread(0)) {
+                r->child[1] = pred->child[0];
+            }
+            else {
+                r->child[1] = pred;
+                r->setThread(1, true);
+            }
+            pred->child[0] = found->child[0];
+            pred->setThread(0, false);
+            path[foundDepth] = pred;
+        }
+        pred->child[1] = found->child[1];
+        pred->setThread(1, found->isThread(1));
+        if (!found->isThread(1)) {
+            NodeType* t = found->child[1];
+            while (!t->isThread(0)) t = t->child[0];
+            t->child[0] = pred;
+        }
+        pred->balance = found->balance;
+        if (parent == NULL) root_ = pred;
+        else parent->child[pdir] = pred;
+    }
+    delete found;
+    --size_;
+
+    while (depth > 0) {
+        --depth;
+        NodeType* curr = path[depth];
+        curr->balance += dirs[depth] ? -1 : 1;
+        if (curr->balance == 1 || curr->balance == -1) {
+            break;
+        }
+        if (curr->balance == 2 || curr->balance == -2) {
+            curr = rebalance(curr);
+            if (depth == 0) root_ = curr;
+            else path[depth - 1]->child[dirs[depth - 1]] = curr;
+            if (curr->balance != 0) {
+                break; // Height stabilized
+            }
+        }
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ThreadedAVLTree class.
+  -----------------------------------------------
+*/
+
+#endif
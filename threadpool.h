@@ -0,0 +1,325 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstdlib>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* A fixed-size work-stealing thread pool for fork-join work. Every worker owns
+* a deque of tasks: it pushes and pops its own tasks at the back (newest
+* first, so it works on the small, cache-warm pieces it just split off) and
+* idle workers steal from the front of the others' deques (oldest first, so
+* a steal grabs the biggest remaining piece). Tasks spawned by threads
+* outside the pool go into one extra shared deque.
+*
+* Tasks are grouped in a TaskGroup. TaskGroup::wait() does not block while
+* work is queued; the waiting thread runs queued tasks itself, so nested
+* fork-join never deadlocks even on a one-thread pool. The first exception
+* thrown by a task in a group is rethrown from wait().
+*/
+class ThreadPool
+{
+public:
+    class TaskGroup;
+
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    size_t size() const;
+    static ThreadPool& shared();
+
+    /**
+    * A set of spawned tasks that can be waited on together.
+    */
+    class TaskGroup
+    {
+    public:
+        explicit TaskGroup(ThreadPool& pool);
+        ~TaskGroup();
+
+        void run(const std::function<void()>& task);
+        void wait();
+
+    protected:
+        friend class ThreadPool;
+        void finished(std::exception_ptr error);
+
+        ThreadPool& pool_;
+        std::atomic<size_t> pending_;
+        std::mutex errorLock_;
+        std::exception_ptr error_;
+
+    private:
+        TaskGroup(const TaskGroup&);
+        TaskGroup& operator=(const TaskGroup&);
+    };
+
+protected:
+    struct Task
+    {
+        std::function<void()> fn;
+        TaskGroup* group;
+    };
+
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    /**
+    * Identifies the pool and queue the calling thread works from.
+    */
+    struct Worker
+    {
+        ThreadPool* pool;
+        size_t index;
+    };
+
+    static Worker& currentWorker();
+    size_t ownQueue() const;
+    void push(const Task& task);
+    bool tryRun(size_t self);
+    void workerLoop(size_t index);
+
+    std::vector<Queue*> queues_;   // one per worker, plus the shared one last
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> queued_;
+    std::atomic<bool> stopping_;
+    std::mutex sleepLock_;
+    std::condition_variable wake_;
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the TaskGroup class.
+  ---------------------------------------------
+*/
+
+inline ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool) :
+    pool_(pool), pending_(0)
+{
+
+}
+
+/**
+* A group must not be destroyed while its tasks still refer to it.
+*/
+inline ThreadPool::TaskGroup::~TaskGroup()
+{
+    while (pending_.load() != 0) {
+        if (!pool_.tryRun(pool_.ownQueue())) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+* Queues a task on the calling thread's deque.
+*/
+inline void ThreadPool::TaskGroup::run(const std::function<void()>& task)
+{
+    pending_.fetch_add(1);
+    Task t = { task, this };
+    pool_.push(t);
+}
+
+/**
+* Returns once every task run through this group has finished, running
+* queued tasks in the meantime.
+*/
+inline void ThreadPool::TaskGroup::wait()
+{
+    size_t self = pool_.ownQueue();
+    while (pending_.load() != 0) {
+        if (!pool_.tryRun(self)) {
+            std::this_thread::yield();
+        }
+    }
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> guard(errorLock_);
+        error = error_;
+        error_ = std::exception_ptr();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+inline void ThreadPool::TaskGroup::finished(std::exception_ptr error)
+{
+    if (error) {
+        std::lock_guard<std::mutex> guard(errorLock_);
+        if (!error_) {
+            error_ = error;
+        }
+    }
+    pending_.fetch_sub(1);
+}
+
+/*
+  -------------------------------------------
+  End implementations for the TaskGroup class.
+  -------------------------------------------
+*/
+
+/*
+  ----------------------------------------------
+  Begin implementations for the ThreadPool class.
+  ----------------------------------------------
+*/
+
+/**
+* Starts the workers. A pool of zero threads is allowed: the thread that
+* waits on a group then runs all of its tasks.
+*/
+inline ThreadPool::ThreadPool(size_t threads) :
+    queued_(0), stopping_(false)
+{
+    for (size_t i = 0; i <= threads; ++i) {
+        queues_.push_back(new Queue());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+        stopping_.store(true);
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        threads_[i].join();
+    }
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        delete queues_[i];
+    }
+}
+
+inline size_t ThreadPool::size() const
+{
+    return threads_.size();
+}
+
+/**
+* A process-wide pool with one worker per hardware thread, created on
+* first use.
+*/
+inline ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+inline ThreadPool::Worker& ThreadPool::currentWorker()
+{
+    static thread_local Worker worker = { NULL, 0 };
+    return worker;
+}
+
+/**
+* The calling thread's own deque: its worker deque if it belongs to this
+* pool, otherwise the shared one.
+*/
+inline size_t ThreadPool::ownQueue() const
+{
+    Worker& w = currentWorker();
+    return w.pool == this ? w.index : queues_.size() - 1;
+}
+
+inline void ThreadPool::push(const Task& task)
+{
+    Queue* q = queues_[ownQueue()];
+    queued_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> guard(q->lock);
+        q->tasks.push_back(task);
+    }
+    {
+        // Taking the lock orders this wake-up after a sleeper's check.
+        std::lock_guard<std::mutex> guard(sleepLock_);
+    }
+    wake_.notify_one();
+}
+
+/**
+* Runs one task, taking the newest from the thread's own deque or else
+* stealing the oldest from another. Returns false if nothing was queued.
+*/
+inline bool ThreadPool::tryRun(size_t self)
+{
+    Task task;
+    bool found = false;
+    {
+        Queue* q = queues_[self];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (!q->tasks.empty()) {
+            task = q->tasks.back();
+            q->tasks.pop_back();
+            found = true;
+        }
+    }
+    for (size_t i = 1; !found && i < queues_.size(); ++i) {
+        Queue* q = queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (!q->tasks.empty()) {
+            task = q->tasks.front();
+            q->tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    queued_.fetch_sub(1);
+
+    std::exception_ptr error;
+    try {
+        task.fn();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    task.group->finished(error);
+    return true;
+}
+
+inline void ThreadPool::workerLoop(size_t index)
+{
+    Worker& w = currentWorker();
+    w.pool = this;
+    w.index = index;
+    while (true) {
+        if (tryRun(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock_);
+        wake_.wait(guard, [this]() { return stopping_.load() || queued_.load() != 0; });
+        if (stopping_.load()) {
+            return;
+        }
+    }
+}
+
+/*
+  --------------------------------------------
+  End implementations for the ThreadPool class.
+  --------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef WEIGHTEDBST_H
+#define WEIGHTEDBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include "bst.h"
+
+template <typename Key, typename Value>
+class WeightedBST;
+
+/**
+* A Node that counts the sampled lookups of its key.
+*/
+template <typename Key, typename Value>
+class WeightedNode : public Node<Key, Value>
+{
+public:
+    WeightedNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual ~WeightedNode();
+
+    uint32_t getHits() const;
+
+protected:
+    template <typename K, typename V> friend class WeightedBST;
+    uint32_t hits_;
+};
+
+template<class Key, class Value>
+WeightedNode<Key, Value>::WeightedNode(const Key& key, const Value& value, Node<Key, Value>* parent) :
+    Node<Key, Value>(key, value, parent), hits_(0)
+{
+
+}
+
+template<class Key, class Value>
+WeightedNode<Key, Value>::~WeightedNode()
+{
+
+}
+
+template<class Key, class Value>
+uint32_t WeightedNode<Key, Value>::getHits() const
+{
+    return hits_;
+}
+
+/**
+* A BinarySearchTree shaped by how often each key is looked up, for
+* workloads whose access distribution is skewed and stable. Lookups
+* (find, operator[], and the search in remove) bump a counter on the node
+* they reach; with a sample rate of r only about one lookup in r is
+* counted, picked at random so periodic access patterns do not alias, and
+* the rest cost one extra multiply.
+*
+* reoptimize rebuilds the tree from the counts with Mehlhorn's bisection
+* rule: each subtree's root is the key whose weight straddles the middle
+* of the subtree's total. A key of weight w then sits at depth at most
+* log2(W / w) + 1 for total weight W, so the expected search depth is
+* within a small constant of the optimal tree's, and the rebuild takes
+* O(n log n) by relinking the existing nodes. Every key weighs its count
+* plus one, so keys never seen are still placed within O(log W) of the
+* root.
+*
+* Between rebuilds the tree is an ordinary unbalanced BST: new keys are
+* inserted at the leaves and removals do not restructure, so a workload
+* that shifts needs another reoptimize. Counters saturate rather than
+* wrap; resetCounts starts a fresh observation window.
+*
+* Since lookups update the counters and the sampling state, even const
+* ones must not run concurrently with anything else.
+*/
+template <typename Key, typename Value>
+class WeightedBST : public BinarySearchTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    explicit WeightedBST(uint32_t sampleRate = 1);
+    WeightedBST(const WeightedBST& other);
+    WeightedBST(WeightedBST&& other);
+    WeightedBST& operator=(const WeightedBST& other);
+    WeightedBST& operator=(WeightedBST&& other);
+
+    void reoptimize();
+    void resetCounts();
+    uint32_t hits(iterator it) const;
+    double averageDepth() const;
+    uint32_t sampleRate() const;
+
+protected:
+    virtual Node<Key, Value>* internalFind(const Key& key) const;
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+
+    static uint64_t weight(const Node<Key, Value>* node);
+    static Node<Key, Value>* buildWeighted(Node<Key, Value>* const* nodes, const uint64_t* prefix,
+                                           size_t lo, size_t hi, Node<Key, Value>* parent);
+    void sample(Node<Key, Value>* node) const;
+
+    uint32_t sampleRate_;
+    mutable uint64_t sampleState_;
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the WeightedBST class.
+  ---------------------------------------------
+*/
+
+/**
+* Counts one lookup in every sampleRate, which must be a power of two
+* (1 counts them all). Throws std::invalid_argument otherwise.
+*/
+template<class Key, class Value>
+WeightedBST<Key, Value>::WeightedBST(uint32_t sampleRate) :
+    sampleRate_(sampleRate), sampleState_(0x9E3779B97F4A7C15ull)
+{
+    if (sampleRate == 0 || (sampleRate & (sampleRate - 1)) != 0) {
+        throw std::invalid_argument("WeightedBST sample rate must be a power of two");
+    }
+}
+
+/**
+* The clone keeps the shape and the counts of other.
+*/
+template<class Key, class Value>
+WeightedBST<Key, Value>::WeightedBST(const WeightedBST& other) :
+    BinarySearchTree<Key, Value>(), sampleRate_(other.sampleRate_), sampleState_(other.sampleState_)
+{
+    this->cloneFrom(other);
+}
+
+template<class Key, class Value>
+WeightedBST<Key, Value>::WeightedBST(WeightedBST&& other) :
+    BinarySearchTree<Key, Value>(std::move(other)), sampleRate_(other.sampleRate_), sampleState_(other.sampleState_)
+{
+
+}
+
+template<class Key, class Value>
+WeightedBST<Key, Value>&
+WeightedBST<Key, Value>::operator=(const WeightedBST& other)
+{
+    BinarySearchTree<Key, Value>::operator=(other);
+    sampleRate_ = other.sampleRate_;
+    sampleState_ = other.sampleState_;
+    return *this;
+}
+
+template<class Key, class Value>
+WeightedBST<Key, Value>&
+WeightedBST<Key, Value>::operator=(WeightedBST&& other)
+{
+    BinarySearchTree<Key, Value>::operator=(std::move(other));
+    sampleRate_ = other.sampleRate_;
+    sampleState_ = other.sampleState_;
+    return *this;
+}
+
+template<class Key, class Value>
+uint32_t WeightedBST<Key, Value>::sampleRate() const
+{
+    return sampleRate_;
+}
+
+/**
+* Returns the sampled lookup count of the item it refers to.
+*/
+template<class Key, class Value>
+uint32_t WeightedBST<Key, Value>::hits(iterator it) const
+{
+    return static_cast<const WeightedNode<Key, Value>*>(this->iteratorNode(it))->hits_;
+}
+
+/**
+* Clears every count, so the next reoptimize only reflects lookups made
+* from now on.
+*/
+template<class Key, class Value>
+void WeightedBST<Key, Value>::resetCounts()
+{
+    for (Node<Key, Value>* node = this->leftmost_; node != NULL; node = this->successor(node)) {
+        static_cast<WeightedNode<Key, Value>*>(node)->hits_ = 0;
+    }
+}
+
+/**
+* Returns the number of nodes a lookup visits on average, weighting each
+* key by its count plus one as reoptimize does. Walks the tree along
+* parent links, so it needs no stack however deep the tree is.
+*/
+template<class Key, class Value>
+double WeightedBST<Key, Value>::averageDepth() const
+{
+    uint64_t total = 0;
+    double weighted = 0;
+    int depth = 0;
+    Node<Key, Value>* prev = NULL;
+    Node<Key, Value>* node = this->root_;
+    while (node != NULL) {
+        Node<Key, Value>* next;
+        if (prev == node->getParent()) {
+            ++depth;
+            total += weight(node);
+            weighted += static_cast<double>(weight(node)) * depth;
+            next = node->getLeft() != NULL ? node->getLeft()
+                 : node->getRight() != NULL ? node->getRight() : node->getParent();
+        }
+        else if (prev == node->getLeft() && node->getRight() != NULL) {
+            next = node->getRight();
+        }
+        else {
+            next = node->getParent();
+        }
+        if (next == node->getParent()) {
+            --depth;
+        }
+        prev = node;
+        node = next;
+    }
+    return total == 0 ? 0 : weighted / total;
+}
+
+/**
+* Relinks the nodes into the weight-balanced shape described above.
+* Collects them in order with their running weight totals, then picks
+* each subtree's root by binary search on the totals: O(n log n) time,
+* O(n) extra space, and no nodes are allocated or moved.
+*/
+template<class Key, class Value>
+void WeightedBST<Key, Value>::reoptimize()
+{
+    std::vector<Node<Key, Value>*> nodes;
+    std::vector<uint64_t> prefix(1, 0);
+    for (Node<Key, Value>* node = this->leftmost_; node != NULL; node = this->successor(node)) {
+        nodes.push_back(node);
+        prefix.push_back(prefix.back() + weight(node));
+    }
+    this->root_ = buildWeighted(nodes.data(), prefix.data(), 0, nodes.size(), NULL);
+}
+
+/**
+* Links nodes[lo, hi) into a subtree under parent and returns its root.
+* prefix[i] is the total weight of nodes[0, i). The root is the node whose
+* weight straddles the middle of the range's total, so neither side holds
+* more than half of it; a node at depth d therefore lies in a subtree of
+* weight at most W / 2^(d - 1), which bounds the recursion, like the tree,
+* at log2(W) + 1 levels.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+WeightedBST<Key, Value>::buildWeighted(Node<Key, Value>* const* nodes, const uint64_t* prefix,
+                                       size_t lo, size_t hi, Node<Key, Value>* parent)
+{
+    if (lo == hi) {
+        return NULL;
+    }
+    uint64_t middle = prefix[lo] + (prefix[hi] - prefix[lo]) / 2;
+    size_t k = std::upper_bound(prefix + lo + 1, prefix + hi, middle) - prefix - 1;
+    Node<Key, Value>* root = nodes[k];
+    root->setParent(parent);
+    root->setLeft(buildWeighted(nodes, prefix, lo, k, root));
+    root->setRight(buildWeighted(nodes, prefix, k + 1, hi, root));
+    return root;
+}
+
+template<class Key, class Value>
+uint64_t WeightedBST<Key, Value>::weight(const Node<Key, Value>* node)
+{
+    return static_cast<const WeightedNode<Key, Value>*>(node)->hits_ + uint64_t(1);
+}
+
+/**
+* Counts a lookup of node if this one is sampled. The choice comes from a
+* 64-bit linear congruential generator. Only its upper 32 bits are tested,
+* since the low bits have short periods. That covers every power-of-two
+* rate a uint32_t can hold, and a rate of 1 counts every lookup.
+*/
+template<class Key, class Value>
+void WeightedBST<Key, Value>::sample(Node<Key, Value>* node) const
+{
+    sampleState_ = sampleState_ * 6364136223846793005ull + 1442695040888963407ull;
+    if ((static_cast<uint32_t>(sampleState_ >> 32) & (sampleRate_ - 1)) != 0) {
+        return;
+    }
+    WeightedNode<Key, Value>* weighted = static_cast<WeightedNode<Key, Value>*>(node);
+    if (weighted->hits_ != UINT32_MAX) {
+        ++weighted->hits_;
+    }
+}
+
+template<class Key, class Value>
+Node<Key, Value>* WeightedBST<Key, Value>::internalFind(const Key& key) const
+{
+    Node<Key, Value>* node = BinarySearchTree<Key, Value>::internalFind(key);
+    if (node != NULL) {
+        sample(node);
+    }
+    return node;
+}
+
+template<class Key, class Value>
+Node<Key, Value>* WeightedBST<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new WeightedNode<Key, Value>(key, value, parent);
+}
+
+template<class Key, class Value>
+Node<Key, Value>* WeightedBST<Key, Value>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    WeightedNode<Key, Value>* copy = static_cast<WeightedNode<Key, Value>*>(createNode(source->getKey(), source->getValue(), parent));
+    copy->hits_ = static_cast<const WeightedNode<Key, Value>*>(source)->hits_;
+    return copy;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the WeightedBST class.
+  ---------------------------------------------
+*/
+
+#endif